@@ -4,18 +4,21 @@
 #include "AI/BTTask_FindPatrolLocation.h"
 #include "AI/ShooterBotWaypoint.h"
 #include "AI/ShooterZombieAIController.h"
+#include "World/ShooterNavQuerySubsystem.h"
 
 /* AI Module includes */
 #include "BehaviorTree/BehaviorTreeComponent.h"
 #include "BehaviorTree/BlackboardComponent.h"
 /* This contains includes all key types like UBlackboardKeyType_Vector used below. */
 #include "BehaviorTree/Blackboard/BlackboardKeyAllTypes.h"
-#include "NavigationSystem.h"
 
 
 
 EBTNodeResult::Type UBTTask_FindPatrolLocation::ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
 {
+	FBTFindPatrolLocationMemory* MyMemory = reinterpret_cast<FBTFindPatrolLocationMemory*>(NodeMemory);
+	MyMemory->RequestId = 0;
+
 	AShooterZombieAIController* MyController = Cast<AShooterZombieAIController>(OwnerComp.GetAIOwner());
 	if (MyController == nullptr)
 	{
@@ -23,21 +26,75 @@ EBTNodeResult::Type UBTTask_FindPatrolLocation::ExecuteTask(UBehaviorTreeCompone
 	}
 
 	AActor* MyWaypoint = MyController->GetWaypoint();
-	if (MyWaypoint)
+	UShooterNavQuerySubsystem* NavQuery = UShooterTickableWorldSubsystem::Get<UShooterNavQuerySubsystem>(MyController);
+	if (MyWaypoint && NavQuery)
 	{
 		/* Find a position that is close to the waypoint. We add a small random to this position to give build predictable patrol patterns  */
 		const float SearchRadius = 200.0f;
 		const FVector SearchOrigin = MyWaypoint->GetActorLocation();
 
-		FNavLocation ResultLocation;
-		UNavigationSystemV1* NavSystem = UNavigationSystemV1::GetNavigationSystem(MyController);
-		if (NavSystem && NavSystem->GetRandomPointInNavigableRadius(SearchOrigin, SearchRadius, ResultLocation))
+		/* Result arrives during a later tick, AbortTask cancels the request so the callback never sees a stale task */
+		MyMemory->RequestId = NavQuery->RequestRandomPointInRadius(SearchOrigin, SearchRadius,
+			FShooterNavPointQueryDelegate::CreateUObject(this, &UBTTask_FindPatrolLocation::OnPatrolLocationFound, TWeakObjectPtr<UBehaviorTreeComponent>(&OwnerComp)));
+
+		if (MyMemory->RequestId != 0)
 		{
-			/* The selected key should be "PatrolLocation" in the BehaviorTree setup */
-			OwnerComp.GetBlackboardComponent()->SetValue<UBlackboardKeyType_Vector>(BlackboardKey.GetSelectedKeyID(), ResultLocation.Location);
-			return EBTNodeResult::Succeeded;
+			return EBTNodeResult::InProgress;
 		}
 	}
 
 	return EBTNodeResult::Failed;
 }
+
+
+EBTNodeResult::Type UBTTask_FindPatrolLocation::AbortTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	FBTFindPatrolLocationMemory* MyMemory = reinterpret_cast<FBTFindPatrolLocationMemory*>(NodeMemory);
+
+	UShooterNavQuerySubsystem* NavQuery = UShooterTickableWorldSubsystem::Get<UShooterNavQuerySubsystem>(OwnerComp.GetOwner());
+	if (NavQuery)
+	{
+		NavQuery->CancelRequest(MyMemory->RequestId);
+	}
+	MyMemory->RequestId = 0;
+
+	return EBTNodeResult::Aborted;
+}
+
+
+uint16 UBTTask_FindPatrolLocation::GetInstanceMemorySize() const
+{
+	return sizeof(FBTFindPatrolLocationMemory);
+}
+
+
+void UBTTask_FindPatrolLocation::OnPatrolLocationFound(bool bSuccess, const FVector& Location, TWeakObjectPtr<UBehaviorTreeComponent> OwnerComp)
+{
+	UBehaviorTreeComponent* MyOwnerComp = OwnerComp.Get();
+	if (MyOwnerComp == nullptr)
+	{
+		return;
+	}
+
+	const int32 InstanceIdx = MyOwnerComp->FindInstanceContainingNode(this);
+	if (InstanceIdx == INDEX_NONE)
+	{
+		return;
+	}
+
+	FBTFindPatrolLocationMemory* MyMemory = reinterpret_cast<FBTFindPatrolLocationMemory*>(MyOwnerComp->GetNodeMemory(this, InstanceIdx));
+	if (MyMemory == nullptr || MyMemory->RequestId == 0)
+	{
+		return;
+	}
+
+	MyMemory->RequestId = 0;
+
+	if (bSuccess)
+	{
+		/* The selected key should be "PatrolLocation" in the BehaviorTree setup */
+		MyOwnerComp->GetBlackboardComponent()->SetValue<UBlackboardKeyType_Vector>(BlackboardKey.GetSelectedKeyID(), Location);
+	}
+
+	FinishLatentTask(*MyOwnerComp, bSuccess ? EBTNodeResult::Succeeded : EBTNodeResult::Failed);
+}
@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AI/ShooterAIStats.h"
+
+
+DEFINE_STAT(STAT_ShooterAI_Logic);
+DEFINE_STAT(STAT_ShooterAI_Navigation);
+DEFINE_STAT(STAT_ShooterAI_Movement);
+DEFINE_STAT(STAT_ShooterAI_Perception);
+
+bool FShooterAIStats::bEnabled = false;
+
+double FShooterAIStats::AccumulatedSeconds[(int32)EShooterAIStat::Count] = { 0.0 };
+
+
+void FShooterAIStats::SetEnabled(bool bEnable)
+{
+	bEnabled = bEnable;
+
+	for (int32 i = 0; i < (int32)EShooterAIStat::Count; i++)
+	{
+		AccumulatedSeconds[i] = 0.0;
+	}
+}
+
+
+bool FShooterAIStats::IsEnabled()
+{
+	return bEnabled;
+}
+
+
+void FShooterAIStats::Accumulate(EShooterAIStat Stat, double Seconds)
+{
+	/* AI runs on the game thread only */
+	check(IsInGameThread());
+
+	AccumulatedSeconds[(int32)Stat] += Seconds;
+}
+
+
+void FShooterAIStats::ConsumeFrame(double OutMilliseconds[(int32)EShooterAIStat::Count])
+{
+	for (int32 i = 0; i < (int32)EShooterAIStat::Count; i++)
+	{
+		OutMilliseconds[i] = AccumulatedSeconds[i] * 1000.0;
+		AccumulatedSeconds[i] = 0.0;
+	}
+}
+
+
+const TCHAR* FShooterAIStats::GetName(EShooterAIStat Stat)
+{
+	switch (Stat)
+	{
+	case EShooterAIStat::Logic:
+		return TEXT("Logic");
+	case EShooterAIStat::Navigation:
+		return TEXT("Navigation");
+	case EShooterAIStat::Movement:
+		return TEXT("Movement");
+	case EShooterAIStat::Perception:
+		return TEXT("Perception");
+	default:
+		return TEXT("Unknown");
+	}
+}
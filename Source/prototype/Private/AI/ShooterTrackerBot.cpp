@@ -4,8 +4,8 @@
 #include "AI/ShooterTrackerBot.h"
 #include "Components/StaticMeshComponent.h"
 #include "Kismet/GameplayStatics.h"
-#include "NavigationSystem.h"
-#include "NavigationPath.h"
+#include "World/ShooterNavQuerySubsystem.h"
+#include "World/ShooterSignificanceSubsystem.h"
 #include "GameFramework/Character.h"
 #include "DrawDebugHelpers.h"
 #include "Components/ShooterHealthComponent.h"
@@ -13,6 +13,7 @@
 #include "Components/SphereComponent.h"
 #include "Sound/SoundCue.h"
 #include "EngineUtils.h"
+#include "AI/ShooterAIStats.h"
 
 
 static int32 DebugTrackerBotDrawing = 0;
@@ -52,6 +53,8 @@ AShooterTrackerBot::AShooterTrackerBot()
 	ExplosionRadius = 350;
 
 	SelfDamageInterval = 0.25f;
+
+	PathRefreshInterval = 5.0f;
 }
 
 // Called when the game starts or when spawned
@@ -61,12 +64,51 @@ void AShooterTrackerBot::BeginPlay()
 
 	if (HasAuthority())
 	{
-		NextPathPoint = GetNextPathPoint();
+		NextPathPoint = GetActorLocation();
+		RequestNextPathPoint();
 
 		// Every second we update our power-level based on nearby bots (CHALLENGE CODE)
 		FTimerHandle TimerHandle_CheckPowerLevel;
 		GetWorldTimerManager().SetTimer(TimerHandle_CheckPowerLevel, this, &AShooterTrackerBot::OnCheckNearbyBots, 1.0f, true);
 	}
+
+	DefaultNetUpdateFrequency = NetUpdateFrequency;
+
+	UShooterSignificanceSubsystem* Significance = UShooterTickableWorldSubsystem::Get<UShooterSignificanceSubsystem>(this);
+	if (Significance)
+	{
+		Significance->Register(this, EShooterSignificanceCategory::TrackerBot, FShooterSignificanceChanged::CreateUObject(this, &AShooterTrackerBot::OnSignificanceChanged));
+	}
+}
+
+
+void AShooterTrackerBot::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UShooterSignificanceSubsystem* Significance = UShooterTickableWorldSubsystem::Get<UShooterSignificanceSubsystem>(this);
+	if (Significance)
+	{
+		Significance->Unregister(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+
+void AShooterTrackerBot::OnSignificanceChanged(EShooterSignificance OldSignificance, EShooterSignificance NewSignificance)
+{
+	/* Indexed by EShooterSignificance (Culled, Low, Medium, High) */
+	static const float NetUpdateFrequencyScales[] = { 0.05f, 0.15f, 0.5f, 1.0f };
+	static const float PathRefreshIntervals[] = { 15.0f, 10.0f, 5.0f, 5.0f };
+
+	const int32 Tier = (int32)NewSignificance;
+
+	if (HasAuthority())
+	{
+		NetUpdateFrequency = DefaultNetUpdateFrequency * NetUpdateFrequencyScales[Tier];
+
+		/* Far away bots chase an outdated target position for longer, picked up on the next refresh */
+		PathRefreshInterval = PathRefreshIntervals[Tier];
+	}
 }
 
 void AShooterTrackerBot::HandleTakeDamage(UShooterHealthComponent* OwningHealthComp, float Health, float HealthDelta, const class UDamageType* DamageType, class AController* InstigatedBy, AActor* DamageCauser)
@@ -88,48 +130,75 @@ void AShooterTrackerBot::HandleTakeDamage(UShooterHealthComponent* OwningHealthC
 	}
 }
 
-FVector AShooterTrackerBot::GetNextPathPoint()
+void AShooterTrackerBot::RequestNextPathPoint()
 {
 	AActor* BestTarget = nullptr;
 	float NearestTargetDistance = FLT_MAX;
 
-	for (TActorIterator<APawn> It(GetWorld()); It; ++It)
 	{
-		APawn* TestPawn = *It;
-		if (TestPawn == nullptr || UShooterHealthComponent::IsFriendly(TestPawn, this))
-		{
-			continue;
-		}
+		SHOOTER_AI_SCOPE(Logic);
 
-		UShooterHealthComponent* TestPawnHealthComp = Cast<UShooterHealthComponent>(TestPawn->GetComponentByClass(UShooterHealthComponent::StaticClass()));
-		if (TestPawnHealthComp && TestPawnHealthComp->GetHealth() > 0.0f)
+		for (TActorIterator<APawn> It(GetWorld()); It; ++It)
 		{
-			float Distance = (TestPawn->GetActorLocation() - GetActorLocation()).Size();
+			APawn* TestPawn = *It;
+			if (TestPawn == nullptr || UShooterHealthComponent::IsFriendly(TestPawn, this))
+			{
+				continue;
+			}
 
-			if (Distance < NearestTargetDistance)
+			UShooterHealthComponent* TestPawnHealthComp = Cast<UShooterHealthComponent>(TestPawn->GetComponentByClass(UShooterHealthComponent::StaticClass()));
+			if (TestPawnHealthComp && TestPawnHealthComp->GetHealth() > 0.0f)
 			{
-				BestTarget = TestPawn;
-				NearestTargetDistance = Distance;
+				float Distance = (TestPawn->GetActorLocation() - GetActorLocation()).Size();
+
+				if (Distance < NearestTargetDistance)
+				{
+					BestTarget = TestPawn;
+					NearestTargetDistance = Distance;
+				}
 			}
 		}
 	}
 
 	if (BestTarget)
 	{
-		UNavigationPath* NavPath = UNavigationSystemV1::FindPathToActorSynchronously(this, GetActorLocation(), BestTarget);
-
-		GetWorldTimerManager().ClearTimer(TimerHandle_RefreshPath);
-		GetWorldTimerManager().SetTimer(TimerHandle_RefreshPath, this, &AShooterTrackerBot::RefreshPath, 5.0f, false);
-
-		if (NavPath && NavPath->PathPoints.Num() > 1)
+		UShooterNavQuerySubsystem* NavQuery = UShooterTickableWorldSubsystem::Get<UShooterNavQuerySubsystem>(this);
+		if (NavQuery)
 		{
-			// Return next point in the path
-			return NavPath->PathPoints[1];
+			NavQuery->CancelRequest(PathRequestId);
+			PathRequestId = NavQuery->RequestPath(GetActorLocation(), BestTarget->GetActorLocation(), this,
+				FShooterNavPathQueryDelegate::CreateUObject(this, &AShooterTrackerBot::OnPathFound));
 		}
+
+		GetWorldTimerManager().ClearTimer(TimerHandle_RefreshPath);
+		GetWorldTimerManager().SetTimer(TimerHandle_RefreshPath, this, &AShooterTrackerBot::RefreshPath, PathRefreshInterval, false);
+	}
+	else
+	{
+		// Nothing to chase
+		CurrentPath.Reset();
+		NextPathPoint = GetActorLocation();
 	}
+}
+
 
-	// Failed to find path
-	return GetActorLocation();
+void AShooterTrackerBot::OnPathFound(bool bSuccess, const TArray<FVector>& PathPoints)
+{
+	PathRequestId = 0;
+
+	if (bSuccess && PathPoints.Num() > 1)
+	{
+		// Follow the whole path, the first point is our own location
+		CurrentPath = PathPoints;
+		CurrentPathIndex = 1;
+		NextPathPoint = CurrentPath[CurrentPathIndex];
+	}
+	else
+	{
+		// Failed to find path
+		CurrentPath.Reset();
+		NextPathPoint = GetActorLocation();
+	}
 }
 
 void AShooterTrackerBot::SelfDestruct()
@@ -184,7 +253,17 @@ void AShooterTrackerBot::Tick(float DeltaTime)
 
 		if (DistanceToTarget <= RequiredDistanceToTarget)
 		{
-			NextPathPoint = GetNextPathPoint();
+			if (CurrentPath.IsValidIndex(CurrentPathIndex + 1))
+			{
+				/* Continue along the path, it is refreshed by the RefreshPath timer as the target moves */
+				CurrentPathIndex++;
+				NextPathPoint = CurrentPath[CurrentPathIndex];
+			}
+			else if (PathRequestId == 0)
+			{
+				/* Wait in place until the pending path arrives */
+				RequestNextPathPoint();
+			}
 
 			if (DebugTrackerBotDrawing)
 			{
@@ -193,6 +272,8 @@ void AShooterTrackerBot::Tick(float DeltaTime)
 		}
 		else
 		{
+			SHOOTER_AI_SCOPE(Movement);
+
 			//Keep moving towards next target
 			FVector ForceDirection = NextPathPoint - GetActorLocation();
 			ForceDirection.Normalize();
@@ -243,6 +324,8 @@ void AShooterTrackerBot::NotifyActorBeginOverlap(AActor* OtherActor)
 
 void AShooterTrackerBot::OnCheckNearbyBots()
 {
+	SHOOTER_AI_SCOPE(Logic);
+
 	// distance to check for nearby bots
 	const float Radius = 600;
 
@@ -309,6 +392,6 @@ void AShooterTrackerBot::OnCheckNearbyBots()
 
 void AShooterTrackerBot::RefreshPath()
 {
-	NextPathPoint = GetNextPathPoint();
+	RequestNextPathPoint();
 }
 
@@ -8,7 +8,8 @@
 #include "AI/ShooterBotWaypoint.h"
 #include "ShooterPlayerState.h"
 /* AI Include */
-#include "Perception/PawnSensingComponent.h"
+#include "Components/ShooterPawnSensingComponent.h"
+#include "AI/ShooterAIStats.h"
 #include "GameFramework/Character.h"
 #include "Components/CapsuleComponent.h"
 #include "GameFramework/NavMovementComponent.h"
@@ -19,6 +20,11 @@
 #include "Components/AudioComponent.h"
 #include "Kismet/GameplayStatics.h"
 #include "Sound/SoundCue.h"
+#include "Sound/SoundConcurrency.h"
+#include "TimerManager.h"
+#include "Net/UnrealNetwork.h"
+#include "World/ShooterSignificanceSubsystem.h"
+#include "Components/ShooterMeleeTraceComponent.h"
 
 
 // Sets default values
@@ -30,7 +36,7 @@ AShooterZombieCharacter::AShooterZombieCharacter(const class FObjectInitializer&
 	/*AIControllerClass = ASZombieAIController::StaticClass();*/
 
 	/* Our sensing component to detect players by visibility and noise checks. */
-	PawnSensingComp = CreateDefaultSubobject<UPawnSensingComponent>(TEXT("PawnSensingComp"));
+	PawnSensingComp = CreateDefaultSubobject<UShooterPawnSensingComponent>(TEXT("PawnSensingComp"));
 	PawnSensingComp->SetPeripheralVisionAngle(60.0f);
 	PawnSensingComp->SightRadius = 2000;
 	PawnSensingComp->HearingThreshold = 600;
@@ -50,6 +56,11 @@ AShooterZombieCharacter::AShooterZombieCharacter(const class FObjectInitializer&
 	AudioLoopComp->bAutoDestroy = false;
 	AudioLoopComp->SetupAttachment(RootComponent);
 
+	AudioLoopState = EZombieAudioState::None;
+
+	MeleeTraceComp = CreateDefaultSubobject<UShooterMeleeTraceComponent>(TEXT("MeleeTraceComp"));
+	MeleeSwingDuration = 0.6f;
+
 	HealthComp->Health = 100;
 	MeleeDamage = 24.0f;
 	SprintingSpeedModifier = 3.0f;
@@ -73,7 +84,26 @@ void AShooterZombieCharacter::BeginPlay()
 		PawnSensingComp->OnHearNoise.AddDynamic(this, &AShooterZombieCharacter::OnHearNoise);
 	}
 
-	BroadcastUpdateAudioLoop(bSensedTarget);
+	MeleeTraceComp->OnMeleeHit.BindUObject(this, &AShooterZombieCharacter::OnMeleeTraceHit);
+
+	if (AudioLoopConcurrency)
+	{
+		AudioLoopComp->ConcurrencySet.Add(AudioLoopConcurrency);
+	}
+
+	if (HasAuthority())
+	{
+		UpdateAudioLoopState();
+	}
+
+	DefaultNetUpdateFrequency = NetUpdateFrequency;
+	DefaultSensingInterval = PawnSensingComp ? PawnSensingComp->SensingInterval : 0.5f;
+
+	UShooterSignificanceSubsystem* Significance = UShooterTickableWorldSubsystem::Get<UShooterSignificanceSubsystem>(this);
+	if (Significance)
+	{
+		Significance->Register(this, EShooterSignificanceCategory::Zombie, FShooterSignificanceChanged::CreateUObject(this, &AShooterZombieCharacter::OnSignificanceChanged));
+	}
 
 	/* Assign a basic name to identify the bots in the HUD. */
 	AShooterPlayerState* PS = Cast<AShooterPlayerState>(GetPlayerState());
@@ -85,10 +115,24 @@ void AShooterZombieCharacter::BeginPlay()
 }
 
 
+void AShooterZombieCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UShooterSignificanceSubsystem* Significance = UShooterTickableWorldSubsystem::Get<UShooterSignificanceSubsystem>(this);
+	if (Significance)
+	{
+		Significance->Unregister(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+
 void AShooterZombieCharacter::Tick(float DeltaSeconds)
 {
 	Super::Tick(DeltaSeconds);
 
+	SHOOTER_AI_SCOPE(Logic);
+
 	/* Check if the last time we sensed a player is beyond the time out value to prevent bot from endlessly following a player. */
 	if (bSensedTarget && (GetWorld()->TimeSeconds - LastSeenTime) > SenseTimeOut 
 		&& (GetWorld()->TimeSeconds - LastHeardTime) > SenseTimeOut)
@@ -101,7 +145,7 @@ void AShooterZombieCharacter::Tick(float DeltaSeconds)
 			AIController->SetTargetEnemy(nullptr);
 
 			/* Stop playing the hunting sound */
-			BroadcastUpdateAudioLoop(false);
+			UpdateAudioLoopState();
 		}
 	}
 }
@@ -114,15 +158,12 @@ void AShooterZombieCharacter::OnSeePlayer(APawn* Pawn)
 		return;
 	}
 
-	if (!bSensedTarget)
-	{
-		BroadcastUpdateAudioLoop(true);
-	}
-
 	/* Keep track of the time the player was last sensed in order to clear the target */
 	LastSeenTime = GetWorld()->GetTimeSeconds();
 	bSensedTarget = true;
 
+	UpdateAudioLoopState();
+
 	AShooterZombieAIController* AIController = Cast<AShooterZombieAIController>(GetController());
 	AShooterBaseCharacter* SensedPawn = Cast<AShooterBaseCharacter>(Pawn);
 	if (AIController && SensedPawn->IsAlive())
@@ -139,14 +180,11 @@ void AShooterZombieCharacter::OnHearNoise(APawn* PawnInstigator, const FVector&
 		return;
 	}
 
-	if (!bSensedTarget)
-	{
-		BroadcastUpdateAudioLoop(true);
-	}
-
 	bSensedTarget = true;
 	LastHeardTime = GetWorld()->GetTimeSeconds();
 
+	UpdateAudioLoopState();
+
 	AShooterZombieAIController* AIController = Cast<AShooterZombieAIController>(GetController());
 	if (AIController)
 	{
@@ -157,7 +195,19 @@ void AShooterZombieCharacter::OnHearNoise(APawn* PawnInstigator, const FVector&
 
 void AShooterZombieCharacter::PerformMeleeStrike(AActor* HitActor)
 {
-	if (HitActor && HitActor != this && IsAlive())
+	/* The overlap of the Blueprint is only the fallback for meshes without hand sockets */
+	if (MeleeTraceComp->IsSwinging())
+	{
+		return;
+	}
+
+	DealMeleeDamage(HitActor);
+}
+
+
+void AShooterZombieCharacter::DealMeleeDamage(AActor* HitActor)
+{
+	if (HitActor && HitActor != this && IsAlive() && !MeleeStrikeHitActors.Contains(HitActor))
 	{
 		ACharacter* OtherPawn = Cast<ACharacter>(HitActor);
 		if (OtherPawn)
@@ -175,6 +225,7 @@ void AShooterZombieCharacter::PerformMeleeStrike(AActor* HitActor)
 
 				/* Set to prevent a zombie to attack multiple times in a very short time */
 				LastMeleeAttackTime = GetWorld()->GetTimeSeconds();
+				MeleeStrikeHitActors.Add(HitActor);
 
 				FPointDamageEvent DmgEvent;
 				DmgEvent.DamageTypeClass = PunchDamageType;
@@ -197,7 +248,7 @@ void AShooterZombieCharacter::SetBotType(EBotBehaviorType NewType)
 		AIController->SetBlackboardBotType(NewType);
 	}
 
-	BroadcastUpdateAudioLoop(bSensedTarget);
+	UpdateAudioLoopState();
 }
 
 
@@ -216,10 +267,23 @@ void AShooterZombieCharacter::PlayHit(float DamageTaken, struct FDamageEvent con
 {
 	Super::PlayHit(DamageTaken, DamageEvent, PawnInstigator, DamageCauser, bKilled);
 
-	/* Stop playing the hunting sound */
-	if (AudioLoopComp && bKilled)
+	/* Stop playing the hunting sound. The pawn is torn off on death so clients reset the state locally. */
+	if (bKilled)
 	{
-		AudioLoopComp->Stop();
+		AudioLoopState = EZombieAudioState::None;
+
+		/* The ragdoll always runs at full rate */
+		UShooterSignificanceSubsystem* Significance = UShooterTickableWorldSubsystem::Get<UShooterSignificanceSubsystem>(this);
+		if (Significance)
+		{
+			Significance->Unregister(this);
+		}
+		GetMesh()->SetComponentTickInterval(0.0f);
+
+		if (AudioLoopComp)
+		{
+			AudioLoopComp->Stop();
+		}
 	}
 }
 
@@ -228,6 +292,19 @@ void AShooterZombieCharacter::SimulateMeleeStrike_Implementation()
 {
 	PlayAnimMontage(MeleeAnimMontage);
 	PlayCharacterSound(SoundAttackMelee);
+
+	/* Damage is only dealt by the server */
+	if (HasAuthority())
+	{
+		MeleeStrikeHitActors.Reset();
+		MeleeTraceComp->StartSwing(GetMesh(), MeleeSwingDuration);
+	}
+}
+
+
+void AShooterZombieCharacter::OnMeleeTraceHit(const FHitResult& Hit)
+{
+	DealMeleeDamage(Hit.GetActor());
 }
 
 
@@ -238,27 +315,135 @@ bool AShooterZombieCharacter::IsSprinting() const
 }
 
 
-void AShooterZombieCharacter::BroadcastUpdateAudioLoop_Implementation(bool bNewSensedTarget)
+void AShooterZombieCharacter::UpdateAudioLoopState()
+{
+	if (!HasAuthority() || !IsAlive())
+	{
+		return;
+	}
+
+	EZombieAudioState NewState = EZombieAudioState::Idle;
+	if (bSensedTarget)
+	{
+		NewState = EZombieAudioState::Hunting;
+	}
+	else if (BotType == EBotBehaviorType::Patrolling)
+	{
+		NewState = EZombieAudioState::Wandering;
+	}
+
+	if (NewState != AudioLoopState)
+	{
+		const EZombieAudioState PreviousState = AudioLoopState;
+		AudioLoopState = NewState;
+
+		/* OnRep is not called on the server, apply it directly for listen servers */
+		if (GetNetMode() != NM_DedicatedServer)
+		{
+			ApplyAudioLoop(PreviousState);
+		}
+	}
+}
+
+
+void AShooterZombieCharacter::OnRep_AudioLoopState(EZombieAudioState PreviousState)
+{
+	ApplyAudioLoop(PreviousState);
+}
+
+
+USoundCue* AShooterZombieCharacter::GetAudioLoopSound(EZombieAudioState State) const
+{
+	switch (State)
+	{
+	case EZombieAudioState::Idle:
+		return SoundIdle;
+	case EZombieAudioState::Wandering:
+		return SoundWandering;
+	case EZombieAudioState::Hunting:
+		return SoundHunting;
+	default:
+		return nullptr;
+	}
+}
+
+
+void AShooterZombieCharacter::ApplyAudioLoop(EZombieAudioState PreviousState)
 {
-	/* Start playing the hunting sound and the "noticed player" sound if the state is about to change */
-	if (bNewSensedTarget && !bSensedTarget)
+	if (AudioLoopComp == nullptr)
+	{
+		return;
+	}
+
+	USoundCue* LoopSound = bAudioLoopCulled ? nullptr : GetAudioLoopSound(AudioLoopState);
+	if (LoopSound == nullptr)
+	{
+		AudioLoopComp->Stop();
+		return;
+	}
+
+	/* Start playing the "noticed player" sound if we just started hunting */
+	if (AudioLoopState == EZombieAudioState::Hunting && PreviousState != EZombieAudioState::Hunting)
 	{
 		PlayCharacterSound(SoundPlayerNoticed);
+	}
 
-		AudioLoopComp->SetSound(SoundHunting);
+	/* Don't restart a loop that is already playing the right sound */
+	if (AudioLoopComp->Sound != LoopSound || !AudioLoopComp->IsPlaying())
+	{
+		AudioLoopComp->SetSound(LoopSound);
 		AudioLoopComp->Play();
 	}
-	else
+}
+
+
+void AShooterZombieCharacter::OnSignificanceChanged(EShooterSignificance OldSignificance, EShooterSignificance NewSignificance)
+{
+	/* Indexed by EShooterSignificance (Culled, Low, Medium, High) */
+	static const float ActorTickIntervals[] = { 0.5f, 0.25f, 0.1f, 0.0f };
+	static const float SensingIntervalScales[] = { 4.0f, 2.0f, 1.0f, 1.0f };
+	static const float NetUpdateFrequencyScales[] = { 0.05f, 0.15f, 0.5f, 1.0f };
+	static const float MeshTickIntervals[] = { 0.25f, 0.1f, 1.0f / 30.0f, 0.0f };
+
+	const int32 Tier = (int32)NewSignificance;
+
+	/* Tick only checks the sense time-out, which is several seconds */
+	SetActorTickInterval(ActorTickIntervals[Tier]);
+
+	if (HasAuthority())
 	{
-		if (BotType == EBotBehaviorType::Patrolling)
+		NetUpdateFrequency = DefaultNetUpdateFrequency * NetUpdateFrequencyScales[Tier];
+
+		if (PawnSensingComp)
 		{
-			AudioLoopComp->SetSound(SoundWandering);
-			AudioLoopComp->Play();
+			/* Stays below SenseTimeOut so a sensed target is not dropped between two sense ticks */
+			PawnSensingComp->SetSensingInterval(FMath::Min(DefaultSensingInterval * SensingIntervalScales[Tier], SenseTimeOut * 0.8f));
 		}
-		else
+	}
+
+	if (GetNetMode() != NM_DedicatedServer)
+	{
+		/* Servers (listen servers included) keep the full animation rate, melee hits are driven by anim notifies */
+		if (GetNetMode() == NM_Client)
 		{
-			AudioLoopComp->SetSound(SoundIdle);
-			AudioLoopComp->Play();
+			GetMesh()->SetComponentTickInterval(MeshTickIntervals[Tier]);
+		}
+
+		const bool bNewCulled = NewSignificance < EShooterSignificance::Medium;
+		if (bNewCulled != bAudioLoopCulled)
+		{
+			bAudioLoopCulled = bNewCulled;
+
+			/* Pass in the current state so becoming significant again does not replay the "noticed" sound */
+			ApplyAudioLoop(AudioLoopState);
 		}
 	}
-}
\ No newline at end of file
+}
+
+
+void AShooterZombieCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(AShooterZombieCharacter, AudioLoopState);
+}
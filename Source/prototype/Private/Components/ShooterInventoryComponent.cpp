@@ -0,0 +1,174 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Components/ShooterInventoryComponent.h"
+#include "ShooterWeapon.h"
+#include "Net/UnrealNetwork.h"
+
+
+void FShooterInventoryArray::PostReplicatedReceive(const FFastArraySerializer::FPostReplicatedReceiveParameters& Parameters)
+{
+	if (Owner)
+	{
+		Owner->OnSlotsReceived();
+	}
+}
+
+
+UShooterInventoryComponent::UShooterInventoryComponent()
+{
+	Slots.Owner = this;
+
+	for (int32 SlotIndex = 0; SlotIndex < NumSlots; SlotIndex++)
+	{
+		SlotToItem[SlotIndex] = INDEX_NONE;
+	}
+
+	SetIsReplicatedByDefault(true);
+}
+
+
+void UShooterInventoryComponent::InitializeSlots()
+{
+	if (Slots.Items.Num() > 0)
+	{
+		return;
+	}
+
+	for (int32 SlotIndex = 0; SlotIndex < NumSlots; SlotIndex++)
+	{
+		FShooterInventorySlot& Entry = Slots.Items.AddDefaulted_GetRef();
+		Entry.Slot = (EInventorySlot)SlotIndex;
+		Slots.MarkItemDirty(Entry);
+
+		SlotToItem[SlotIndex] = SlotIndex;
+	}
+}
+
+
+void UShooterInventoryComponent::OnSlotsReceived()
+{
+	for (int32 SlotIndex = 0; SlotIndex < NumSlots; SlotIndex++)
+	{
+		SlotToItem[SlotIndex] = INDEX_NONE;
+	}
+
+	for (int32 ItemIndex = 0; ItemIndex < Slots.Items.Num(); ItemIndex++)
+	{
+		const int32 SlotIndex = (int32)Slots.Items[ItemIndex].Slot;
+		if (SlotIndex < NumSlots)
+		{
+			SlotToItem[SlotIndex] = ItemIndex;
+		}
+	}
+}
+
+
+bool UShooterInventoryComponent::AddWeapon(AShooterWeapon* Weapon)
+{
+	if (Weapon == nullptr || !IsSlotAvailable(Weapon->GetStorageSlot()))
+	{
+		return false;
+	}
+
+	InitializeSlots();
+
+	FShooterInventorySlot& Entry = Slots.Items[SlotToItem[(int32)Weapon->GetStorageSlot()]];
+	Entry.Weapon = Weapon;
+	Slots.MarkItemDirty(Entry);
+	return true;
+}
+
+
+bool UShooterInventoryComponent::RemoveWeapon(AShooterWeapon* Weapon)
+{
+	if (!Contains(Weapon))
+	{
+		return false;
+	}
+
+	FShooterInventorySlot& Entry = Slots.Items[SlotToItem[(int32)Weapon->GetStorageSlot()]];
+	Entry.Weapon = nullptr;
+	Slots.MarkItemDirty(Entry);
+	return true;
+}
+
+
+AShooterWeapon* UShooterInventoryComponent::GetWeapon(EInventorySlot Slot) const
+{
+	const int32 SlotIndex = (int32)Slot;
+	if (SlotIndex >= NumSlots || !Slots.Items.IsValidIndex(SlotToItem[SlotIndex]))
+	{
+		return nullptr;
+	}
+
+	return Slots.Items[SlotToItem[SlotIndex]].Weapon;
+}
+
+
+bool UShooterInventoryComponent::IsSlotAvailable(EInventorySlot Slot) const
+{
+	return (int32)Slot < NumSlots && GetWeapon(Slot) == nullptr;
+}
+
+
+bool UShooterInventoryComponent::Contains(AShooterWeapon* Weapon) const
+{
+	return Weapon && GetWeapon(Weapon->GetStorageSlot()) == Weapon;
+}
+
+
+int32 UShooterInventoryComponent::GetNumWeapons() const
+{
+	int32 NumWeapons = 0;
+	for (int32 SlotIndex = 0; SlotIndex < NumSlots; SlotIndex++)
+	{
+		if (GetWeapon((EInventorySlot)SlotIndex))
+		{
+			NumWeapons++;
+		}
+	}
+
+	return NumWeapons;
+}
+
+
+AShooterWeapon* UShooterInventoryComponent::GetFirstWeapon() const
+{
+	for (int32 SlotIndex = 0; SlotIndex < NumSlots; SlotIndex++)
+	{
+		AShooterWeapon* Weapon = GetWeapon((EInventorySlot)SlotIndex);
+		if (Weapon)
+		{
+			return Weapon;
+		}
+	}
+
+	return nullptr;
+}
+
+
+AShooterWeapon* UShooterInventoryComponent::GetAdjacentWeapon(AShooterWeapon* From, int32 Direction) const
+{
+	const int32 StartIndex = Contains(From) ? (int32)From->GetStorageSlot() : 0;
+	const int32 Step = Direction < 0 ? NumSlots - 1 : 1;
+
+	for (int32 Offset = 1; Offset <= NumSlots; Offset++)
+	{
+		AShooterWeapon* Weapon = GetWeapon((EInventorySlot)((StartIndex + Step * Offset) % NumSlots));
+		if (Weapon)
+		{
+			return Weapon;
+		}
+	}
+
+	return nullptr;
+}
+
+
+void UShooterInventoryComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(UShooterInventoryComponent, Slots);
+}
@@ -0,0 +1,145 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Components/ShooterMeleeTraceComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "../prototype.h"
+
+
+UShooterMeleeTraceComponent::UShooterMeleeTraceComponent()
+{
+	/* Only ticks during a swing, after animation so the sockets are in their pose of this frame */
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+	PrimaryComponentTick.TickGroup = TG_PostUpdateWork;
+
+	TraceRadius = 10.0f;
+	MaxSubstepDistance = 30.0f;
+	MaxSubsteps = 8;
+	TraceChannel = COLLISION_WEAPON;
+
+	SwingEndTime = 0.0f;
+}
+
+
+void UShooterMeleeTraceComponent::StartSwing(USkeletalMeshComponent* Mesh, float Duration)
+{
+	if (Mesh == nullptr || !Mesh->DoesSocketExist(BladeStartSocket) || !Mesh->DoesSocketExist(BladeEndSocket))
+	{
+		return;
+	}
+
+	SwingMesh = Mesh;
+	SwingEndTime = GetWorld()->GetTimeSeconds() + Duration;
+	HitActors.Reset();
+
+	LastPose = SamplePose();
+	SetComponentTickEnabled(true);
+}
+
+
+void UShooterMeleeTraceComponent::StopSwing()
+{
+	SwingMesh.Reset();
+	HitActors.Reset();
+	SetComponentTickEnabled(false);
+}
+
+
+bool UShooterMeleeTraceComponent::IsSwinging() const
+{
+	return SwingMesh.IsValid();
+}
+
+
+UShooterMeleeTraceComponent::FBladePose UShooterMeleeTraceComponent::SamplePose() const
+{
+	const USkeletalMeshComponent* Mesh = SwingMesh.Get();
+
+	FBladePose Pose;
+	Pose.ComponentTransform = Mesh->GetComponentTransform();
+	Pose.StartSocket = Mesh->GetSocketTransform(BladeStartSocket, RTS_Component);
+	Pose.EndSocket = Mesh->GetSocketTransform(BladeEndSocket, RTS_Component);
+	return Pose;
+}
+
+
+void UShooterMeleeTraceComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (!SwingMesh.IsValid() || GetWorld()->GetTimeSeconds() > SwingEndTime)
+	{
+		StopSwing();
+		return;
+	}
+
+	const FBladePose CurrentPose = SamplePose();
+
+	/* Sub-step by the distance the faster end of the blade travelled */
+	const float StartMove = FVector::Dist(LastPose.ComponentTransform.TransformPosition(LastPose.StartSocket.GetLocation()), CurrentPose.ComponentTransform.TransformPosition(CurrentPose.StartSocket.GetLocation()));
+	const float EndMove = FVector::Dist(LastPose.ComponentTransform.TransformPosition(LastPose.EndSocket.GetLocation()), CurrentPose.ComponentTransform.TransformPosition(CurrentPose.EndSocket.GetLocation()));
+	const int32 NumSubsteps = FMath::Clamp(FMath::CeilToInt(FMath::Max(StartMove, EndMove) / FMath::Max(1.0f, MaxSubstepDistance)), 1, FMath::Max(1, MaxSubsteps));
+
+	FBladePose From = LastPose;
+	for (int32 Step = 1; Step <= NumSubsteps && SwingMesh.IsValid(); Step++)
+	{
+		FBladePose To = CurrentPose;
+		if (Step < NumSubsteps)
+		{
+			const float Alpha = (float)Step / NumSubsteps;
+			To.ComponentTransform.Blend(LastPose.ComponentTransform, CurrentPose.ComponentTransform, Alpha);
+			To.StartSocket.Blend(LastPose.StartSocket, CurrentPose.StartSocket, Alpha);
+			To.EndSocket.Blend(LastPose.EndSocket, CurrentPose.EndSocket, Alpha);
+		}
+
+		SweepBlade(From, To);
+		From = To;
+	}
+
+	LastPose = CurrentPose;
+}
+
+
+void UShooterMeleeTraceComponent::SweepBlade(const FBladePose& From, const FBladePose& To)
+{
+	const FVector FromStart = From.ComponentTransform.TransformPosition(From.StartSocket.GetLocation());
+	const FVector FromEnd = From.ComponentTransform.TransformPosition(From.EndSocket.GetLocation());
+	const FVector ToStart = To.ComponentTransform.TransformPosition(To.StartSocket.GetLocation());
+	const FVector ToEnd = To.ComponentTransform.TransformPosition(To.EndSocket.GetLocation());
+
+	/* The capsule keeps the orientation of the target pose while it moves, sub-steps keep the rotation per sweep small */
+	const FVector BladeAxis = ToEnd - ToStart;
+	const float HalfLength = BladeAxis.Size() * 0.5f;
+	const FQuat CapsuleRotation = HalfLength > KINDA_SMALL_NUMBER ? FRotationMatrix::MakeFromZ(BladeAxis).ToQuat() : FQuat::Identity;
+
+	FCollisionQueryParams QueryParams(TEXT("MeleeTrace"), false, GetOwner());
+	QueryParams.bReturnPhysicalMaterial = true;
+	if (GetOwner() && GetOwner()->GetOwner())
+	{
+		/* The pawn holding the weapon */
+		QueryParams.AddIgnoredActor(GetOwner()->GetOwner());
+	}
+
+	TArray<FHitResult> Hits;
+	GetWorld()->SweepMultiByChannel(Hits, (FromStart + FromEnd) * 0.5f, (ToStart + ToEnd) * 0.5f, CapsuleRotation, TraceChannel,
+		FCollisionShape::MakeCapsule(TraceRadius, HalfLength + TraceRadius), QueryParams);
+
+	for (const FHitResult& Hit : Hits)
+	{
+		AActor* HitActor = Hit.GetActor();
+		if (HitActor == nullptr || HitActors.Contains(HitActor))
+		{
+			continue;
+		}
+
+		HitActors.Add(HitActor);
+		OnMeleeHit.ExecuteIfBound(Hit);
+
+		/* The callback may end the swing */
+		if (!SwingMesh.IsValid())
+		{
+			return;
+		}
+	}
+}
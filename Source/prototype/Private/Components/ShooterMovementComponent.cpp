@@ -3,6 +3,7 @@
 
 #include "Components/ShooterMovementComponent.h"
 #include "ShooterCharacter.h"
+#include "AI/ShooterAIStats.h"
 
 float UShooterMovementComponent::GetMaxSpeed() const
 {
@@ -23,4 +24,19 @@ float UShooterMovementComponent::GetMaxSpeed() const
 	}
 
 	return MaxSpeed;
+}
+
+
+void UShooterMovementComponent::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	/* Only bots count towards the AI movement cost, players are measured by the regular engine stats */
+	if (PawnOwner && !PawnOwner->IsPlayerControlled())
+	{
+		SHOOTER_AI_SCOPE(Movement);
+		Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	}
+	else
+	{
+		Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	}
 }
\ No newline at end of file
@@ -0,0 +1,13 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Components/ShooterPawnSensingComponent.h"
+#include "AI/ShooterAIStats.h"
+
+
+void UShooterPawnSensingComponent::UpdateAISensing()
+{
+	SHOOTER_AI_SCOPE(Perception);
+
+	Super::UpdateAISensing();
+}
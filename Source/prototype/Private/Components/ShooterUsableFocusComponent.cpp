@@ -0,0 +1,112 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Components/ShooterUsableFocusComponent.h"
+#include "Items/ShooterUsableActor.h"
+#include "ShooterCharacter.h"
+
+
+UShooterUsableFocusComponent::UShooterUsableFocusComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	FocusUpdateInterval = 0.1f;
+
+	/* Enabled once the owner is locally controlled. Only movable objects can be usable, level geometry is left out */
+	SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	SetCollisionObjectType(ECC_WorldDynamic);
+	SetCollisionResponseToAllChannels(ECR_Ignore);
+	SetCollisionResponseToChannel(ECC_WorldDynamic, ECR_Overlap);
+	SetCollisionResponseToChannel(ECC_PhysicsBody, ECR_Overlap);
+	SetGenerateOverlapEvents(true);
+	SetCanEverAffectNavigation(false);
+}
+
+
+void UShooterUsableFocusComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	/* No local players */
+	if (GetNetMode() == NM_DedicatedServer)
+	{
+		SetComponentTickEnabled(false);
+		return;
+	}
+
+	SetComponentTickInterval(FocusUpdateInterval);
+
+	OnComponentBeginOverlap.AddDynamic(this, &UShooterUsableFocusComponent::OnUsableBeginOverlap);
+	OnComponentEndOverlap.AddDynamic(this, &UShooterUsableFocusComponent::OnUsableEndOverlap);
+}
+
+
+AShooterUsableActor* UShooterUsableFocusComponent::GetFocusedActor() const
+{
+	return FocusedActor.Get();
+}
+
+
+void UShooterUsableFocusComponent::OnUsableBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+{
+	AShooterUsableActor* Usable = Cast<AShooterUsableActor>(OtherActor);
+	if (Usable)
+	{
+		NearbyUsables.AddUnique(Usable);
+	}
+}
+
+
+void UShooterUsableFocusComponent::OnUsableEndOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
+{
+	AShooterUsableActor* Usable = Cast<AShooterUsableActor>(OtherActor);
+	if (Usable)
+	{
+		NearbyUsables.RemoveSingleSwap(Usable, false);
+	}
+}
+
+
+void UShooterUsableFocusComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	AShooterCharacter* MyPawn = Cast<AShooterCharacter>(GetOwner());
+	const bool bLocallyControlled = MyPawn && MyPawn->IsLocallyControlled();
+
+	/* Possession can change at any time, the overlaps are only kept while there is a local player to focus for */
+	if (bLocallyControlled != IsCollisionEnabled())
+	{
+		SetCollisionEnabled(bLocallyControlled ? ECollisionEnabled::QueryOnly : ECollisionEnabled::NoCollision);
+		if (!bLocallyControlled)
+		{
+			NearbyUsables.Reset();
+		}
+	}
+
+	NearbyUsables.RemoveAllSwap([](const TWeakObjectPtr<AShooterUsableActor>& Usable) { return !Usable.IsValid(); });
+
+	/* Nothing usable in reach, the trace couldn't find anything either */
+	SetFocusedActor(bLocallyControlled && NearbyUsables.Num() > 0 ? MyPawn->GetUsableInView() : nullptr);
+}
+
+
+void UShooterUsableFocusComponent::SetFocusedActor(AShooterUsableActor* NewFocus)
+{
+	AShooterUsableActor* OldFocus = FocusedActor.Get();
+	if (OldFocus == NewFocus)
+	{
+		return;
+	}
+
+	if (OldFocus)
+	{
+		OldFocus->OnEndFocus();
+	}
+
+	FocusedActor = NewFocus;
+
+	if (NewFocus)
+	{
+		NewFocus->OnBeginFocus();
+	}
+}
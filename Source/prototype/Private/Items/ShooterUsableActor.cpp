@@ -9,6 +9,9 @@ AShooterUsableActor::AShooterUsableActor()
 {
 	MeshComp = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("Mesh"));
 	RootComponent = MeshComp;
+
+	/* Found by the focus sphere of nearby players */
+	MeshComp->SetGenerateOverlapEvents(true);
 }
 
 void AShooterUsableActor::OnUsed(APawn* InstigatorPawn)
@@ -5,6 +5,7 @@
 #include "ShooterCharacter.h"
 #include "ShooterWeapon.h"
 #include "ShooterPlayerController.h"
+#include "World/ShooterWeaponPoolSubsystem.h"
 
 
 AShooterWeaponPickup::AShooterWeaponPickup()
@@ -24,9 +25,8 @@ void AShooterWeaponPickup::OnUsed(APawn* InstigatorPawn)
 		/* Fetch the default variables of the class we are about to pick up and check if the storage slot is available on the pawn. */
 		if (MyPawn->WeaponSlotAvailable(WeaponClass->GetDefaultObject<AShooterWeapon>()->GetStorageSlot()))
 		{
-			FActorSpawnParameters SpawnInfo;
-			SpawnInfo.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
-			AShooterWeapon* NewWeapon = GetWorld()->SpawnActor<AShooterWeapon>(WeaponClass, SpawnInfo);
+			UShooterWeaponPoolSubsystem* WeaponPool = UShooterWeaponPoolSubsystem::Get(this);
+			AShooterWeapon* NewWeapon = WeaponPool ? WeaponPool->AcquireWeapon(WeaponClass) : nullptr;
 
 			MyPawn->AddWeapon(NewWeapon);
 
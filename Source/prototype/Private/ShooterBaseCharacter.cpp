@@ -14,6 +14,13 @@
 #include "Kismet/GameplayStatics.h"
 #include "Sound/SoundCue.h"
 #include "World/ShooterGameMode.h"
+#include "World/ShooterSignificanceSubsystem.h"
+#include "World/ShooterLagCompensationSubsystem.h"
+#include "World/ShooterFootstepSubsystem.h"
+#include "World/ShooterRagdollSubsystem.h"
+#include "World/ShooterDamageBatchSubsystem.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+#include "PhysicsEngine/SkeletalBodySetup.h"
 
 
 // Sets default values
@@ -40,6 +47,11 @@ AShooterBaseCharacter::AShooterBaseCharacter(const class FObjectInitializer& Obj
 
 	LeftFootArrowComp = CreateDefaultSubobject<UArrowComponent>(TEXT("LeftFootArrowComp"));
 	LeftFootArrowComp->SetupAttachment(GetMesh(), LeftFootSocketName);
+
+	FootprintLifeSpan = 10.0f;
+	FootstepSurface = SurfaceType_Default;
+	FootstepSurfaceLocation = FVector::ZeroVector;
+	FootstepSurfaceRefreshDistance = 150.0f;
 	
 }
 
@@ -160,6 +172,26 @@ void AShooterBaseCharacter::BeginPlay()
 	Super::BeginPlay();
 
 	HealthComp->OnHealthChanged.AddDynamic(this, &AShooterBaseCharacter::OnHealthChanged);
+
+	/* Record hitbox history so client hit reports can be validated against where we were when they fired */
+	if (HasAuthority())
+	{
+		if (UShooterLagCompensationSubsystem* LagCompensation = UShooterTickableWorldSubsystem::Get<UShooterLagCompensationSubsystem>(this))
+		{
+			LagCompensation->Register(this);
+		}
+	}
+}
+
+
+void AShooterBaseCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UShooterLagCompensationSubsystem* LagCompensation = UShooterTickableWorldSubsystem::Get<UShooterLagCompensationSubsystem>(this))
+	{
+		LagCompensation->Unregister(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
 
@@ -170,6 +202,56 @@ float AShooterBaseCharacter::TakeDamage(float Damage, struct FDamageEvent const&
 		return 0.f;
 	}
 
+	/* Pellets and explosions of one frame are applied together at its end, before game mode rules */
+	UShooterDamageBatchSubsystem* DamageBatch = HasAuthority() ? UShooterTickableWorldSubsystem::Get<UShooterDamageBatchSubsystem>(this) : nullptr;
+	if (DamageBatch && DamageBatch->QueueDamage(this, Damage, DamageEvent, EventInstigator, DamageCauser))
+	{
+		return Damage;
+	}
+
+	return ApplyDamage(Damage, DamageEvent, EventInstigator, DamageCauser);
+}
+
+
+void AShooterBaseCharacter::ApplyQueuedDamage(TArrayView<const FShooterQueuedHit> Hits)
+{
+	/* Each source is summed up once, at the position of its first hit */
+	TArray<bool, TInlineAllocator<16>> Applied;
+	Applied.AddZeroed(Hits.Num());
+
+	for (int32 First = 0; First < Hits.Num() && HealthComp->GetHealth() > 0.f; First++)
+	{
+		if (Applied[First])
+		{
+			continue;
+		}
+
+		float Damage = 0.f;
+		int32 Last = First;
+		for (int32 Index = First; Index < Hits.Num(); Index++)
+		{
+			if (!Applied[Index] && Hits[Index].IsSameSource(Hits[First]))
+			{
+				Damage += Hits[Index].Damage;
+				Applied[Index] = true;
+				Last = Index;
+			}
+		}
+
+		/* The latest hit of the source drives the hit reaction, or the death impulse when the sum kills */
+		const FShooterQueuedHit& Hit = Hits[Last];
+		ApplyDamage(Damage, Hit.GetDamageEvent(), Hit.EventInstigator.Get(), Hit.DamageCauser.Get());
+	}
+}
+
+
+float AShooterBaseCharacter::ApplyDamage(float Damage, struct FDamageEvent const& DamageEvent, class AController* EventInstigator, class AActor* DamageCauser)
+{
+	if (HealthComp->GetHealth() <= 0.f)
+	{
+		return 0.f;
+	}
+
 	/* Modify based based on gametype rules */
 	AShooterGameMode* MyGameMode = Cast<AShooterGameMode>(GetWorld()->GetAuthGameMode());
 	Damage = MyGameMode ? MyGameMode->ModifyDamage(Damage, this, DamageEvent, EventInstigator, DamageCauser) : Damage;
@@ -262,6 +344,12 @@ void AShooterBaseCharacter::OnDeath(float KillingDamage, FDamageEvent const& Dam
 	TearOff();
 	bDied = true;
 
+	/* Ragdolls no longer follow the recorded animation, hits on the corpse fall back to the regular validation */
+	if (UShooterLagCompensationSubsystem* LagCompensation = UShooterTickableWorldSubsystem::Get<UShooterLagCompensationSubsystem>(this))
+	{
+		LagCompensation->Unregister(this);
+	}
+
 	PlayHit(KillingDamage, DamageEvent, PawnInstigator, DamageCauser, true);
 
 	DetachFromControllerPendingDestroy();
@@ -303,6 +391,7 @@ void AShooterBaseCharacter::SetRagdollPhysics()
 {
 	bool bInRagdoll = false;
 	USkeletalMeshComponent* Mesh3P = GetMesh();
+	UShooterRagdollSubsystem* RagdollSubsystem = UShooterTickableWorldSubsystem::Get<UShooterRagdollSubsystem>(this);
 
 	if (IsPendingKill())
 	{
@@ -312,6 +401,11 @@ void AShooterBaseCharacter::SetRagdollPhysics()
 	{
 		bInRagdoll = false;
 	}
+	/* Nobody watches the bodies on a dedicated server */
+	else if (RagdollSubsystem && !RagdollSubsystem->ShouldSimulateRagdoll())
+	{
+		bInRagdoll = false;
+	}
 	else
 	{
 		Mesh3P->SetAllBodiesSimulatePhysics(true);
@@ -320,6 +414,12 @@ void AShooterBaseCharacter::SetRagdollPhysics()
 		Mesh3P->bBlendPhysics = true;
 
 		bInRagdoll = true;
+
+		/* Frozen or removed once too many bodies simulate at the same time */
+		if (RagdollSubsystem)
+		{
+			RagdollSubsystem->AddRagdoll(this);
+		}
 	}
 
 	UCharacterMovementComponent* CharacterComp = Cast<UCharacterMovementComponent>(GetMovementComponent());
@@ -386,6 +486,7 @@ void AShooterBaseCharacter::ReplicateHit(float DamageTaken, struct FDamageEvent
 	LastTakeHitInfo.PawnInstigator = Cast<AShooterBaseCharacter>(PawnInstigator);
 	LastTakeHitInfo.DamageCauser = DamageCauser;
 	LastTakeHitInfo.SetDamageEvent(DamageEvent);
+	LastTakeHitInfo.PackHitBone(GetMesh());
 	LastTakeHitInfo.bKilled = bKilled;
 	LastTakeHitInfo.EnsureReplication();
 }
@@ -393,6 +494,8 @@ void AShooterBaseCharacter::ReplicateHit(float DamageTaken, struct FDamageEvent
 
 void AShooterBaseCharacter::OnRep_LastTakeHitInfo()
 {
+	LastTakeHitInfo.UnpackHitBone(GetMesh());
+
 	if (LastTakeHitInfo.bKilled)
 	{
 		OnDeath(LastTakeHitInfo.ActualDamage, LastTakeHitInfo.GetDamageEvent(), LastTakeHitInfo.PawnInstigator.Get(), LastTakeHitInfo.DamageCauser.Get());
@@ -441,52 +544,66 @@ void AShooterBaseCharacter::OnHealthChanged(UShooterHealthComponent* OwningHealt
 }
 
 
-void AShooterBaseCharacter::TraceFootprint(FHitResult& OutHit, const FVector& Location) const
+void AShooterBaseCharacter::RightFootDown()
 {
-	FVector Start = Location;
-	FVector End = Location;
-
-	Start.Z += 20.0f;
-	End.Z -= 20.0f;
-
-	//Re-initialize hit info
-	OutHit = FHitResult(ForceInit);
+	SpawnFootprint(RightFootArrowComp, RightFootprintDecal);
+}
 
-	FCollisionQueryParams TraceParams(FName(TEXT("Footprint trace")), true, this);
-	TraceParams.bReturnPhysicalMaterial = true;
 
-	GetWorld()->LineTraceSingleByChannel(OutHit, Start, End, ECC_Visibility, TraceParams);
+void AShooterBaseCharacter::LeftFootDown()
+{
+	SpawnFootprint(LeftFootArrowComp, LeftFootprintDecal);
 }
 
-void AShooterBaseCharacter::RightFootDown() const
+
+void AShooterBaseCharacter::SpawnFootprint(UArrowComponent* FootArrow, TSubclassOf<AActor> FootprintDecal)
 {
-	SpawnFootprint(RightFootArrowComp, RightFootprintDecal);
+	/* Purely cosmetic, nobody sees them on a dedicated server */
+	if (FootprintDecal == nullptr || GetNetMode() == NM_DedicatedServer)
+	{
+		return;
+	}
+
+	const FVector FootWorldPosition = FootArrow->GetComponentLocation();
+
+	/* Only footprints close to a viewer are worth the trace and decal */
+	UShooterSignificanceSubsystem* Significance = UShooterTickableWorldSubsystem::Get<UShooterSignificanceSubsystem>(this);
+	if (Significance && Significance->ClaimEffectSignificance(EShooterSignificanceCategory::Footprint, FootWorldPosition) < EShooterSignificance::Medium)
+	{
+		return;
+	}
+
+	UShooterFootstepSubsystem* Footsteps = UShooterTickableWorldSubsystem::Get<UShooterFootstepSubsystem>(this);
+	if (Footsteps)
+	{
+		Footsteps->QueueFootstep(this, FootWorldPosition, FootArrow->GetForwardVector(), FootprintDecal, FootprintLifeSpan);
+	}
 }
 
 
-void AShooterBaseCharacter::LeftFootDown() const
+bool AShooterBaseCharacter::HasFootstepSurface(const UPrimitiveComponent* Floor, const FVector& FootLocation) const
 {
-	SpawnFootprint(LeftFootArrowComp, LeftFootprintDecal);
+	if (!FootstepFloor.IsValid() || FootstepFloor.Get() != Floor)
+	{
+		return false;
+	}
+
+	/* One material is one surface. Landscapes have none of their own, their layers carry the physical materials */
+	return Floor->GetNumMaterials() == 1 || FVector::DistSquared(FootstepSurfaceLocation, FootLocation) < FMath::Square(FootstepSurfaceRefreshDistance);
 }
 
 
-void AShooterBaseCharacter::SpawnFootprint(UArrowComponent* FootArrow, TSubclassOf<AActor> FootprintDecal) const
+void AShooterBaseCharacter::SetFootstepSurface(UPrimitiveComponent* Floor, const FVector& FootLocation, EPhysicalSurface Surface)
 {
-	FHitResult HitResult;
-	FVector FootWorldPosition = FootArrow->GetComponentTransform().GetLocation();
-	FVector Forward = FootArrow->GetForwardVector();
-
-	TraceFootprint(HitResult, FootWorldPosition);
+	FootstepFloor = Floor;
+	FootstepSurfaceLocation = FootLocation;
+	FootstepSurface = Surface;
+}
 
-	// Create a rotator using the landscape normal and our foot forward vectors
-	// Note that we use the function ZX to enforce the normal direction (Z)
-	FQuat floorRot = FRotationMatrix::MakeFromZX(HitResult.Normal, Forward).ToQuat();
-	//FQuat offsetRot(FRotator(0.0f, -90.0f, 0.0f));
-	FRotator Rotation = (floorRot).Rotator();
 
-	// Spawn decal and particle emitter
-	if (FootprintDecal)
-		AActor* DecalInstance = GetWorld()->SpawnActor(FootprintDecal, &HitResult.Location, &Rotation);
+TEnumAsByte<EPhysicalSurface> AShooterBaseCharacter::GetFootstepSurface() const
+{
+	return FootstepSurface;
 }
 
 
@@ -500,4 +617,116 @@ void AShooterBaseCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>
 
 	DOREPLIFETIME(AShooterBaseCharacter, LastTakeHitInfo);
 	DOREPLIFETIME(AShooterBaseCharacter, bDied);
-}
\ No newline at end of file
+}
+
+
+void FTakeHitInfo::PackHitBone(const USkeletalMeshComponent* Mesh)
+{
+	HitBodyIndex = INDEX_NONE;
+
+	const UPhysicsAsset* PhysicsAsset = Mesh ? Mesh->GetPhysicsAsset() : nullptr;
+	if (PhysicsAsset && DamageEventClassID == FPointDamageEvent::ClassID && PointDamageEvent.HitInfo.BoneName != NAME_None)
+	{
+		const int32 BodyIndex = PhysicsAsset->FindBodyIndex(PointDamageEvent.HitInfo.BoneName);
+		HitBodyIndex = BodyIndex <= MAX_uint8 ? BodyIndex : INDEX_NONE;
+	}
+}
+
+
+void FTakeHitInfo::UnpackHitBone(const USkeletalMeshComponent* Mesh)
+{
+	const UPhysicsAsset* PhysicsAsset = Mesh ? Mesh->GetPhysicsAsset() : nullptr;
+	if (PhysicsAsset && DamageEventClassID == FPointDamageEvent::ClassID && PhysicsAsset->SkeletalBodySetups.IsValidIndex(HitBodyIndex))
+	{
+		PointDamageEvent.HitInfo.BoneName = PhysicsAsset->SkeletalBodySetups[HitBodyIndex]->BoneName;
+	}
+}
+
+
+bool FTakeHitInfo::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	/* 0 general, 1 point, 2 radial */
+	uint8 EventKind = DamageEventClassID == FPointDamageEvent::ClassID ? 1 : (DamageEventClassID == FRadialDamageEvent::ClassID ? 2 : 0);
+	uint8 bKilledBit = bKilled;
+	Ar.SerializeBits(&EventKind, 2);
+	Ar.SerializeBits(&bKilledBit, 1);
+	Ar << EnsureReplicationByte;
+
+	if (Ar.IsLoading())
+	{
+		DamageEventClassID = EventKind == 1 ? FPointDamageEvent::ClassID : (EventKind == 2 ? FRadialDamageEvent::ClassID : FDamageEvent::ClassID);
+		bKilled = bKilledBit != 0;
+	}
+
+	/* Quarter points are plenty for hit feedback, small hits fit in a byte */
+	uint32 PackedDamage = (uint32)FMath::Clamp(FMath::RoundToInt(ActualDamage * 4.0f), 0, MAX_int32);
+	Ar.SerializeIntPacked(PackedDamage);
+
+	FDamageEvent& DamageEvent = EventKind == 1 ? (FDamageEvent&)PointDamageEvent : (EventKind == 2 ? (FDamageEvent&)RadialDamageEvent : GeneralDamageEvent);
+
+	UObject* InstigatorObject = PawnInstigator.Get();
+	UObject* CauserObject = DamageCauser.Get();
+	UObject* DamageTypeObject = DamageEvent.DamageTypeClass;
+	/* The result only tells whether the reference is mapped yet, instigators and causers that aren't relevant to the client stay null */
+	Map->SerializeObject(Ar, AShooterBaseCharacter::StaticClass(), InstigatorObject);
+	Map->SerializeObject(Ar, AActor::StaticClass(), CauserObject);
+	Map->SerializeObject(Ar, UClass::StaticClass(), DamageTypeObject);
+	bOutSuccess = true;
+
+	if (Ar.IsLoading())
+	{
+		ActualDamage = PackedDamage * 0.25f;
+		PawnInstigator = Cast<AShooterBaseCharacter>(InstigatorObject);
+		DamageCauser = Cast<AActor>(CauserObject);
+		DamageEvent.DamageTypeClass = Cast<UClass>(DamageTypeObject);
+	}
+
+	if (EventKind == 1)
+	{
+		FVector_NetQuantizeNormal ShotDirection = PointDamageEvent.ShotDirection;
+		FVector_NetQuantize ImpactPoint = PointDamageEvent.HitInfo.ImpactPoint;
+		bool bDirectionSuccess = true;
+		bool bPointSuccess = true;
+		ShotDirection.NetSerialize(Ar, Map, bDirectionSuccess);
+		ImpactPoint.NetSerialize(Ar, Map, bPointSuccess);
+
+		uint8 bHasBody = HitBodyIndex != INDEX_NONE;
+		Ar.SerializeBits(&bHasBody, 1);
+
+		uint8 PackedBodyIndex = bHasBody ? (uint8)HitBodyIndex : 0;
+		if (bHasBody)
+		{
+			Ar << PackedBodyIndex;
+		}
+
+		if (Ar.IsLoading())
+		{
+			/* The bone name is restored by UnpackHitBone, everything else of the hit stays default */
+			PointDamageEvent.ShotDirection = ShotDirection;
+			PointDamageEvent.HitInfo = FHitResult(ForceInit);
+			PointDamageEvent.HitInfo.ImpactPoint = ImpactPoint;
+			PointDamageEvent.HitInfo.Location = ImpactPoint;
+			HitBodyIndex = bHasBody ? PackedBodyIndex : INDEX_NONE;
+		}
+	}
+	else if (EventKind == 2)
+	{
+		FVector_NetQuantize Origin = RadialDamageEvent.Origin;
+		bool bOriginSuccess = true;
+		Origin.NetSerialize(Ar, Map, bOriginSuccess);
+
+		/* The impulse only needs the reach of the explosion */
+		uint32 PackedRadius = (uint32)FMath::Clamp(FMath::RoundToInt(RadialDamageEvent.Params.GetMaxRadius()), 0, MAX_int32);
+		Ar.SerializeIntPacked(PackedRadius);
+
+		if (Ar.IsLoading())
+		{
+			RadialDamageEvent.Origin = Origin;
+			RadialDamageEvent.Params = FRadialDamageParams();
+			RadialDamageEvent.Params.OuterRadius = PackedRadius;
+			RadialDamageEvent.ComponentHits.Reset();
+		}
+	}
+
+	return true;
+}
@@ -12,6 +12,9 @@
 #include "Items/ShooterUsableActor.h"
 #include "Items/ShooterWeaponPickup.h"
 #include "Sound/SoundCue.h"
+#include "World/ShooterWeaponPoolSubsystem.h"
+#include "Components/ShooterInventoryComponent.h"
+#include "Components/ShooterUsableFocusComponent.h"
 
 // Sets default values
 AShooterCharacter::AShooterCharacter(const class FObjectInitializer& ObjectInitializer)
@@ -33,6 +36,11 @@ AShooterCharacter::AShooterCharacter(const class FObjectInitializer& ObjectIniti
 	CameraComp = CreateDefaultSubobject<UCameraComponent>(TEXT("CameraComp"));
 	CameraComp->SetupAttachment(SpringArmComp);
 
+	InventoryComp = CreateDefaultSubobject<UShooterInventoryComponent>(TEXT("InventoryComp"));
+
+	UsableFocusComp = CreateDefaultSubobject<UShooterUsableFocusComponent>(TEXT("UsableFocusComp"));
+	UsableFocusComp->SetupAttachment(RootComponent);
+
 	ZoomedFOV = 65.0f;
 	ZoomInterpSpeed = 20;
 
@@ -43,7 +51,6 @@ AShooterCharacter::AShooterCharacter(const class FObjectInitializer& ObjectIniti
 
 	MaxUseDistance = 500;
 	DropWeaponMaxDistance = 100;
-	bHasNewFocus = true;
 	TargetingSpeedModifier = 0.5f;
 	SprintingSpeedModifier = 2.5f;
 }
@@ -97,6 +104,9 @@ void AShooterCharacter::BeginPlay()
 	Super::BeginPlay();
 	
 	DefaultFOV = CameraComp->FieldOfView;
+
+	/* Usable actors further away than this can't be in reach of the view trace */
+	UsableFocusComp->SetSphereRadius(MaxUseDistance);
 }
 
 void AShooterCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
@@ -183,12 +193,19 @@ AShooterUsableActor* AShooterCharacter::GetUsableInView() const
 }
 
 
+AShooterUsableActor* AShooterCharacter::GetFocusedUsable() const
+{
+	return UsableFocusComp->GetFocusedActor();
+}
+
+
 void AShooterCharacter::Use()
 {
 	// Only allow on server. If called on client push this request to the server
 	if (HasAuthority())
 	{
-		AShooterUsableActor* Usable = GetUsableInView();
+		/* The host uses what it sees on screen, remote players are traced by the server */
+		AShooterUsableActor* Usable = IsLocallyControlled() ? GetFocusedUsable() : GetUsableInView();
 		if (Usable)
 		{
 			Usable->OnUsed(this);
@@ -431,35 +448,6 @@ void AShooterCharacter::Tick(float DeltaTime)
 	{
 		SetSprinting(true);
 	}
-
-	if (Controller && Controller->IsLocalController())
-	{
-		AShooterUsableActor* Usable = GetUsableInView();
-
-		// End Focus
-		if (FocusedUsableActor != Usable)
-		{
-			if (FocusedUsableActor)
-			{
-				FocusedUsableActor->OnEndFocus();
-			}
-
-			bHasNewFocus = true;
-		}
-
-		// Assign new Focus
-		FocusedUsableActor = Usable;
-
-		// Start Focus.
-		if (Usable)
-		{
-			if (bHasNewFocus)
-			{
-				Usable->OnBeginFocus();
-				bHasNewFocus = false;
-			}
-		}
-	}
 }
 
 
@@ -511,9 +499,9 @@ void AShooterCharacter::DestroyInventory()
 		return;
 	}
 
-	for (int32 i = Inventory.Num() - 1; i >= 0; i--)
+	for (int32 SlotIndex = 0; SlotIndex < UShooterInventoryComponent::NumSlots; SlotIndex++)
 	{
-		AShooterWeapon* Weapon = Inventory[i];
+		AShooterWeapon* Weapon = InventoryComp->GetWeapon((EInventorySlot)SlotIndex);
 		if (Weapon)
 		{
 			RemoveWeapon(Weapon, true);
@@ -606,13 +594,27 @@ void AShooterCharacter::AddWeapon(AShooterWeapon* Weapon)
 {
 	if (Weapon && HasAuthority())
 	{
+		if (!InventoryComp->AddWeapon(Weapon))
+		{
+			/* Slot is taken, the weapon never was part of the inventory */
+			UShooterWeaponPoolSubsystem* WeaponPool = UShooterWeaponPoolSubsystem::Get(this);
+			if (WeaponPool)
+			{
+				WeaponPool->ReleaseWeapon(Weapon);
+			}
+			else
+			{
+				Weapon->Destroy();
+			}
+			return;
+		}
+
 		Weapon->OnEnterInventory(this);
-		Inventory.AddUnique(Weapon);
 
 		// Equip first weapon in inventory
-		if (Inventory.Num() > 0 && CurrentWeapon == nullptr)
+		if (CurrentWeapon == nullptr)
 		{
-			EquipWeapon(Inventory[0]);
+			EquipWeapon(Weapon);
 		}
 	}
 }
@@ -624,27 +626,36 @@ void AShooterCharacter::RemoveWeapon(AShooterWeapon* Weapon, bool bDestroy)
 	{
 		bool bIsCurrent = CurrentWeapon == Weapon;
 
-		if (Inventory.Contains(Weapon))
+		if (InventoryComp->RemoveWeapon(Weapon))
 		{
 			Weapon->OnLeaveInventory();
 		}
-		Inventory.RemoveSingle(Weapon);
 
 		/* Replace weapon if we removed our current weapon */
-		if (bIsCurrent && Inventory.Num() > 0)
+		AShooterWeapon* FirstWeapon = InventoryComp->GetFirstWeapon();
+		if (bIsCurrent && FirstWeapon)
 		{
-			SetCurrentWeapon(Inventory[0]);
+			SetCurrentWeapon(FirstWeapon);
 		}
 
 		/* Clear reference to weapon if we have no items left in inventory */
-		if (Inventory.Num() == 0)
+		if (FirstWeapon == nullptr)
 		{
 			SetCurrentWeapon(nullptr);
 		}
 
+		/* Removed weapons go back to the pool, respawns and pickups reuse them */
 		if (bDestroy)
 		{
-			Weapon->Destroy();
+			UShooterWeaponPoolSubsystem* WeaponPool = UShooterWeaponPoolSubsystem::Get(this);
+			if (WeaponPool)
+			{
+				WeaponPool->ReleaseWeapon(Weapon);
+			}
+			else
+			{
+				Weapon->Destroy();
+			}
 		}
 	}
 }
@@ -652,10 +663,9 @@ void AShooterCharacter::RemoveWeapon(AShooterWeapon* Weapon, bool bDestroy)
 
 void AShooterCharacter::NextWeapon()
 {
-	if (Inventory.Num() >= 2) // TODO: Check for weaponstate.
+	if (InventoryComp->GetNumWeapons() >= 2) // TODO: Check for weaponstate.
 	{
-		const int32 CurrentWeaponIndex = Inventory.IndexOfByKey(CurrentWeapon);
-		AShooterWeapon* NextWeapon = Inventory[(CurrentWeaponIndex + 1) % Inventory.Num()];
+		AShooterWeapon* NextWeapon = InventoryComp->GetAdjacentWeapon(CurrentWeapon, 1);
 		EquipWeapon(NextWeapon);
 	}
 }
@@ -663,10 +673,9 @@ void AShooterCharacter::NextWeapon()
 
 void AShooterCharacter::PrevWeapon()
 {
-	if (Inventory.Num() >= 2) // TODO: Check for weaponstate.
+	if (InventoryComp->GetNumWeapons() >= 2) // TODO: Check for weaponstate.
 	{
-		const int32 CurrentWeaponIndex = Inventory.IndexOfByKey(CurrentWeapon);
-		AShooterWeapon* PrevWeapon = Inventory[(CurrentWeaponIndex - 1 + Inventory.Num()) % Inventory.Num()];
+		AShooterWeapon* PrevWeapon = InventoryComp->GetAdjacentWeapon(CurrentWeapon, -1);
 		EquipWeapon(PrevWeapon);
 	}
 }
@@ -674,34 +683,20 @@ void AShooterCharacter::PrevWeapon()
 
 void AShooterCharacter::EquipPrimaryWeapon()
 {
-	if (Inventory.Num() >= 1)
+	AShooterWeapon* Weapon = InventoryComp->GetWeapon(EInventorySlot::Primary);
+	if (Weapon)
 	{
-		/* Find first weapon that uses primary slot. */
-		for (int32 i = 0; i < Inventory.Num(); i++)
-		{
-			AShooterWeapon* Weapon = Inventory[i];
-			if (Weapon->GetStorageSlot() == EInventorySlot::Primary)
-			{
-				EquipWeapon(Weapon);
-			}
-		}
+		EquipWeapon(Weapon);
 	}
 }
 
 
 void AShooterCharacter::EquipSecondaryWeapon()
 {
-	if (Inventory.Num() >= 1)
+	AShooterWeapon* Weapon = InventoryComp->GetWeapon(EInventorySlot::Secondary);
+	if (Weapon)
 	{
-		/* Find first weapon that uses secondary slot. */
-		for (int32 i = 0; i < Inventory.Num(); i++)
-		{
-			AShooterWeapon* Weapon = Inventory[i];
-			if (Weapon->GetStorageSlot() == EInventorySlot::Secondary)
-			{
-				EquipWeapon(Weapon);
-			}
-		}
+		EquipWeapon(Weapon);
 	}
 }
 
@@ -712,22 +707,7 @@ void AShooterCharacter::CloseWeapon()
 
 bool AShooterCharacter::WeaponSlotAvailable(EInventorySlot CheckSlot)
 {
-	/* Iterate all weapons to see if requested slot is occupied */
-	for (int32 i = 0; i < Inventory.Num(); i++)
-	{
-		AShooterWeapon* Weapon = Inventory[i];
-		if (Weapon)
-		{
-			if (Weapon->GetStorageSlot() == CheckSlot)
-				return false;
-		}
-	}
-
-	return true;
-
-	/* Special find function as alternative to looping the array and performing if statements
-		the [=] prefix means "capture by value", other options include [] "capture nothing" and [&] "capture by reference" */
-		//return nullptr == Inventory.FindByPredicate([=](ASWeapon* W){ return W->GetStorageSlot() == CheckSlot; });
+	return InventoryComp->IsSlotAvailable(CheckSlot);
 }
 
 
@@ -846,9 +826,6 @@ void AShooterCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& Ou
 	DOREPLIFETIME(AShooterCharacter, LastTakeHitInfo);
 
 	DOREPLIFETIME(AShooterCharacter, CurrentWeapon);
-	DOREPLIFETIME(AShooterCharacter, Inventory);
-	/* If we did not display the current inventory on the player mesh we could optimize replication by using this replication condition. */
-	/* DOREPLIFETIME_CONDITION(ASCharacter, Inventory, COND_OwnerOnly);*/
 }
 
 
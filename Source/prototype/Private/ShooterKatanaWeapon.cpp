@@ -2,14 +2,171 @@
 
 
 #include "ShooterKatanaWeapon.h"
+#include "ShooterCharacter.h"
+#include "Components/ShooterMeleeTraceComponent.h"
+#include "World/ShooterLagCompensationSubsystem.h"
+#include "../prototype.h"
+
+
+namespace ShooterMelee
+{
+	/* Network jitter accepted on the swing rate and on hits arriving after the end of the swing */
+	const float SwingLeeway = 0.1f;
+}
+
 
 AShooterKatanaWeapon::AShooterKatanaWeapon()
 {
 	WeaponType = EWeaponType::Katana;
 
+	MeleeTraceComp = CreateDefaultSubobject<UShooterMeleeTraceComponent>(TEXT("MeleeTraceComp"));
+	MeleeTraceComp->BladeStartSocket = "BladeStartSocket";
+	MeleeTraceComp->BladeEndSocket = "BladeEndSocket";
+
+	SwingDuration = 0.5f;
+	HitDamage = 60.0f;
+	MaxHitReach = 250.0f;
+	ServerSwingStartTime = 0.0f;
+	ServerSwingEndTime = 0.0f;
 }
 
+
+void AShooterKatanaWeapon::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	MeleeTraceComp->OnMeleeHit.BindUObject(this, &AShooterKatanaWeapon::OnMeleeHit);
+}
+
+
 void AShooterKatanaWeapon::FireWeapon()
 {
+	MeleeTraceComp->StartSwing(GetWeaponMesh(), SwingDuration);
+}
+
+
+void AShooterKatanaWeapon::OnEnterPool()
+{
+	Super::OnEnterPool();
+
+	MeleeTraceComp->StopSwing();
+	ServerSwingHitActors.Reset();
+	ServerSwingStartTime = 0.0f;
+	ServerSwingEndTime = 0.0f;
+}
+
+
+void AShooterKatanaWeapon::HandleFiring()
+{
+	/* Before firing, which moves LastFireTime. Swings can't overlap and come no faster than the refire rate */
+	if (HasAuthority() && MyPawn && !MyPawn->IsLocallyControlled() && IsEquipped() && GetCurrentState() == EWeaponState::Firing && CanFire())
+	{
+		const float TimeSeconds = GetWorld()->GetTimeSeconds();
+		const float MinSwingInterval = FMath::Max(GetTimeBetweenShots(), SwingDuration) - ShooterMelee::SwingLeeway;
+		if (ServerSwingStartTime <= 0.0f || TimeSeconds - ServerSwingStartTime >= MinSwingInterval)
+		{
+			ServerSwingHitActors.Reset();
+			ServerSwingStartTime = TimeSeconds;
+			ServerSwingEndTime = TimeSeconds + SwingDuration + ShooterMelee::SwingLeeway;
+		}
+	}
+
+	Super::HandleFiring();
+}
+
+
+void AShooterKatanaWeapon::OnMeleeHit(const FHitResult& Hit)
+{
+	if (HasAuthority())
+	{
+		DealMeleeDamage(Hit);
+	}
+	// Only actors controlled by the server are worth reporting, our own torn off ragdolls are not
+	else if (Hit.GetActor()->GetRemoteRole() == ROLE_Authority)
+	{
+		ServerNotifyMeleeHit(Hit, UShooterLagCompensationSubsystem::GetShotTimestamp(this));
+	}
+}
+
+
+void AShooterKatanaWeapon::DealMeleeDamage(const FHitResult& Hit)
+{
+	FPointDamageEvent PointDmg;
+	PointDmg.DamageTypeClass = DamageType;
+	PointDmg.HitInfo = Hit;
+	PointDmg.ShotDirection = MyPawn ? (Hit.ImpactPoint - MyPawn->GetActorLocation()).GetSafeNormal() : FVector::ZeroVector;
+	PointDmg.Damage = HitDamage;
+
+	Hit.GetActor()->TakeDamage(PointDmg.Damage, PointDmg, MyPawn ? MyPawn->Controller : nullptr, this);
+}
+
+
+bool AShooterKatanaWeapon::ServerNotifyMeleeHit_Validate(const FHitResult Hit, float ClientTimestamp)
+{
+	return true;
+}
+
+
+void AShooterKatanaWeapon::ServerNotifyMeleeHit_Implementation(const FHitResult Hit, float ClientTimestamp)
+{
+	AActor* HitActor = Hit.GetActor();
+	if (HitActor == nullptr || HitActor == MyPawn || !IsEquipped())
+	{
+		return;
+	}
+
+	/* Only within a swing the server accounted for itself through the fire state */
+	if (GetWorld()->GetTimeSeconds() > ServerSwingEndTime)
+	{
+		return;
+	}
+
+	if (ServerSwingHitActors.Contains(HitActor))
+	{
+		return;
+	}
+
+	FHitResult ConfirmedHit;
+	if (ValidateMeleeHit(Hit, ClientTimestamp, ConfirmedHit))
+	{
+		ServerSwingHitActors.Add(HitActor);
+		DealMeleeDamage(ConfirmedHit);
+	}
+}
+
+
+bool AShooterKatanaWeapon::ValidateMeleeHit(const FHitResult& Hit, float ClientTimestamp, FHitResult& OutHit) const
+{
+	if (MyPawn == nullptr)
+	{
+		return false;
+	}
+
+	/* The blade can't reach further than this from where the server has the pawn */
+	const FVector PawnLocation = MyPawn->GetActorLocation();
+	if (FVector::DistSquared(PawnLocation, Hit.ImpactPoint) > FMath::Square(MaxHitReach))
+	{
+		return false;
+	}
+
+	/* Nor through walls. The target itself is ignored, characters are checked against their rewound hitboxes below */
+	FCollisionQueryParams QueryParams(TEXT("MeleeHitValidation"), false, MyPawn);
+	QueryParams.AddIgnoredActor(this);
+	QueryParams.AddIgnoredActor(Hit.GetActor());
+	if (GetWorld()->LineTraceTestByChannel(PawnLocation, Hit.ImpactPoint, COLLISION_WEAPON, QueryParams))
+	{
+		return false;
+	}
+
+	/* Same pawn history as ranged fire: the hit has to be on a hitbox of the character as it was at the time of the swing */
+	AShooterBaseCharacter* HitCharacter = Cast<AShooterBaseCharacter>(Hit.GetActor());
+	UShooterLagCompensationSubsystem* LagCompensation = UShooterTickableWorldSubsystem::Get<UShooterLagCompensationSubsystem>(this);
+	if (HitCharacter && LagCompensation && LagCompensation->IsTracked(HitCharacter))
+	{
+		const FVector TraceDir = (Hit.ImpactPoint - PawnLocation).GetSafeNormal();
+		return LagCompensation->RewindTrace(HitCharacter, ClientTimestamp, PawnLocation, PawnLocation + TraceDir * MaxHitReach, OutHit);
+	}
 
+	OutHit = Hit;
+	return true;
 }
@@ -2,6 +2,8 @@
 
 
 #include "ShooterProjectileWeapon.h"
+#include "ShooterCharacter.h"
+#include "World/ShooterProjectileSubsystem.h"
 
 AShooterProjectileWeapon::AShooterProjectileWeapon()
 {
@@ -19,6 +21,13 @@ void AShooterProjectileWeapon::FireWeapon()
 		MyOwner->GetActorEyesViewPoint(EyeLocation, EyeRotation);
 
 		FVector MuzzleLocation = GetMuzzleLocation();
+
+		/* Simulated without an actor until it hits something that needs one */
+		UShooterProjectileSubsystem* Projectiles = UShooterTickableWorldSubsystem::Get<UShooterProjectileSubsystem>(this);
+		if (Projectiles && Projectiles->LaunchProjectile(ProjectileClass, MuzzleLocation, EyeRotation, GetPawnOwner()))
+		{
+			return;
+		}
 		
 		FActorSpawnParameters SpawnParams;
 		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
@@ -13,6 +13,22 @@
 #include "Net/UnrealNetwork.h"
 #include "Sound/SoundCue.h"
 #include "ShooterPlayerController.h"
+#include "World/ShooterLagCompensationSubsystem.h"
+
+
+static float AmmoCorrectionInterval = 0.25f;
+FAutoConsoleVariableRef CVARAmmoCorrectionInterval(
+	TEXT("COOP.AmmoCorrectionInterval"),
+	AmmoCorrectionInterval,
+	TEXT("Seconds between authoritative ammo updates sent to a firing client"),
+	ECVF_Cheat);
+
+
+namespace ShooterWeaponNet
+{
+	/* Most shots one acknowledgement may charge, anything beyond was never fired at the weapon's rate */
+	const int32 MaxShotsPerAck = 32;
+}
 
 static int32 DebugWeaponDrawing = 0;
 
@@ -29,8 +45,20 @@ AShooterWeapon::AShooterWeapon()
 	MeshComp = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("MeshComp"));
 	RootComponent = MeshComp;
 
+	/* Only ticks while the fire scheduler has a shot pending */
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+
 	bIsEquipped = false;
 	CurrentState = EWeaponState::Idle;
+	bFireScheduled = false;
+	FireTimeAccumulator = 0.0f;
+	BurstStartFrame = 0;
+	CurrentShotTimeOffset = 0.0f;
+	LocalShotSequence = 0;
+	AckedShotSequence = 0;
+	AcceptedShotMask = 0;
+	bFireStatePending = false;
 
 	WeaponType = EWeaponType::Rifle;
 	StorageSlot = EInventorySlot::Primary;
@@ -43,6 +71,7 @@ AShooterWeapon::AShooterWeapon()
 	MuzzleSocketName = "MuzzleSocket";
 
 	ShotsPerMinute = 700;
+	MaxShotsPerFrame = 4;
 	StartAmmo = 999;
 	MaxAmmo = 999;
 	MaxAmmoPerClip = 30;
@@ -59,6 +88,11 @@ void AShooterWeapon::PostInitializeComponents()
 	TimeBetweenShots = 60.0f / ShotsPerMinute;
 	CurrentAmmo = FMath::Min(StartAmmo, MaxAmmo);
 	CurrentAmmoInClip = FMath::Min(MaxAmmoPerClip, StartAmmo);
+
+	if (HasAuthority())
+	{
+		SendAmmoCorrection();
+	}
 }
 
 
@@ -218,6 +252,12 @@ void AShooterWeapon::OnEnterInventory(AShooterCharacter* NewOwner)
 {
 	SetOwningPawn(NewOwner);
 	AttachMeshToPawn(StorageSlot);
+
+	/* Shot sequences start over with every owner */
+	LocalShotSequence = 0;
+	AckedShotSequence = 0;
+	AcceptedShotMask = 0;
+	UpdateAuthoritativeAmmo(true);
 }
 
 
@@ -237,6 +277,35 @@ void AShooterWeapon::OnLeaveInventory()
 }
 
 
+void AShooterWeapon::OnEnterPool()
+{
+	GetWorldTimerManager().ClearAllTimersForObject(this);
+
+	bWantsToFire = false;
+	bPendingReload = false;
+	bPendingEquip = false;
+	bIsEquipped = false;
+	SetWeaponState(EWeaponState::Idle);
+	LastFireTime = 0.0f;
+
+	CurrentAmmo = FMath::Min(StartAmmo, MaxAmmo);
+	CurrentAmmoInClip = FMath::Min(MaxAmmoPerClip, StartAmmo);
+	LocalShotSequence = 0;
+	AckedShotSequence = 0;
+	AcceptedShotMask = 0;
+	SendAmmoCorrection();
+
+	/* Clients keep the actor, the last update (no pawn, mesh detached) is sent before its channel goes dormant */
+	SetNetDormancy(DORM_DormantAll);
+}
+
+
+void AShooterWeapon::OnLeavePool()
+{
+	SetNetDormancy(DORM_Awake);
+}
+
+
 bool AShooterWeapon::IsEquipped() const
 {
 	return bIsEquipped;
@@ -268,7 +337,9 @@ void AShooterWeapon::StopFire()
 {
 	if (!HasAuthority())
 	{
-		ServerStopFire();
+		/* Reports go out first, the server would otherwise charge their shots as lost */
+		FlushShotReports();
+		ServerStopFire(LocalShotSequence);
 	}
 
 	if (bWantsToFire)
@@ -291,14 +362,15 @@ void AShooterWeapon::ServerStartFire_Implementation()
 }
 
 
-bool AShooterWeapon::ServerStopFire_Validate()
+bool AShooterWeapon::ServerStopFire_Validate(uint16 ShotSequence)
 {
 	return true;
 }
 
 
-void AShooterWeapon::ServerStopFire_Implementation()
+void AShooterWeapon::ServerStopFire_Implementation(uint16 ShotSequence)
 {
+	AcknowledgeShots(ShotSequence);
 	StopFire();
 }
 
@@ -312,6 +384,12 @@ bool AShooterWeapon::CanFire() const
 }
 
 
+float AShooterWeapon::GetTimeBetweenShots() const
+{
+	return TimeBetweenShots;
+}
+
+
 FVector AShooterWeapon::GetAdjustedAim() const
 {
 	APawn* MyInstigator = GetInstigator();
@@ -356,19 +434,34 @@ FVector AShooterWeapon::GetCameraDamageStartLocation(const FVector& AimDir) cons
 
 FHitResult AShooterWeapon::WeaponTrace(const FVector& TraceFrom, const FVector& TraceTo) const
 {
-	FCollisionQueryParams TraceParams(TEXT("WeaponTrace"), true, GetInstigator());
-	TraceParams.bReturnPhysicalMaterial = true;
-
 	FHitResult Hit(ForceInit);
-	GetWorld()->LineTraceSingleByChannel(Hit, TraceFrom, TraceTo, COLLISION_WEAPON, TraceParams);
+	GetWorld()->LineTraceSingleByChannel(Hit, TraceFrom, TraceTo, COLLISION_WEAPON, GetWeaponTraceParams());
 
 	return Hit;
 }
 
 
+FTraceHandle AShooterWeapon::AsyncWeaponTrace(const FVector& TraceFrom, const FVector& TraceTo, FTraceDelegate* Delegate, uint32 UserData) const
+{
+	return GetWorld()->AsyncLineTraceByChannel(EAsyncTraceType::Single, TraceFrom, TraceTo, COLLISION_WEAPON, GetWeaponTraceParams(),
+		FCollisionResponseParams::DefaultResponseParam, Delegate, UserData);
+}
+
+
+FCollisionQueryParams AShooterWeapon::GetWeaponTraceParams() const
+{
+	FCollisionQueryParams TraceParams(TEXT("WeaponTrace"), true, GetInstigator());
+	TraceParams.bReturnPhysicalMaterial = true;
+
+	return TraceParams;
+}
+
+
 
 void AShooterWeapon::HandleFiring()
 {
+	bool bFiredShot = false;
+
 	if (CurrentAmmoInClip > 0 && CanFire())
 	{
 		if (GetNetMode() != NM_DedicatedServer)
@@ -378,7 +471,14 @@ void AShooterWeapon::HandleFiring()
 
 		if (MyPawn && MyPawn->IsLocallyControlled())
 		{
+			/* Before firing, shot reports sent from within FireWeapon already include this shot */
+			if (!HasAuthority())
+			{
+				LocalShotSequence++;
+			}
+
 			FireWeapon();
+			bFiredShot = true;
 
 			UseAmmo();
 
@@ -412,16 +512,18 @@ void AShooterWeapon::HandleFiring()
 
 	if (MyPawn && MyPawn->IsLocallyControlled())
 	{
-		if (!HasAuthority())
+		/* One fire state per frame for all shots fired in it. Shots that were reported in a batch are accounted for on the server when the batch arrives */
+		if (!HasAuthority() && bFiredShot && !UsesBatchedShotReports() && !bFireStatePending)
 		{
-			ServerHandleFiring();
+			bFireStatePending = true;
+			GetWorldTimerManager().SetTimerForNextTick(this, &AShooterWeapon::FlushShotReports);
 		}
 
 		/* Retrigger HandleFiring on a delay for automatic weapons */
 		bRefiring = (CurrentState == EWeaponState::Firing && TimeBetweenShots > 0.0f);
 		if (bRefiring)
 		{
-			GetWorldTimerManager().SetTimer(TimerHandle_HandleFiring, this, &AShooterWeapon::HandleFiring, TimeBetweenShots, false);
+			ScheduleNextShot();
 		}
 	}
 
@@ -431,22 +533,92 @@ void AShooterWeapon::HandleFiring()
 		MyPawn->MakePawnNoise(1.0f);
 	}
 
-	LastFireTime = GetWorld()->GetTimeSeconds();
+	LastFireTime = GetWorld()->GetTimeSeconds() - CurrentShotTimeOffset;
 }
 
 
-bool AShooterWeapon::ServerHandleFiring_Validate()
+void AShooterWeapon::ScheduleNextShot()
+{
+	bFireScheduled = true;
+	SetActorTickEnabled(true);
+}
+
+
+void AShooterWeapon::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	/* The time of the frame the burst started in is already part of the accumulator */
+	if (GFrameCounter != BurstStartFrame)
+	{
+		FireTimeAccumulator += DeltaSeconds;
+	}
+
+	/* Fire every shot that was due this frame, the remainder carries over so the rate doesn't depend on the frame rate */
+	int32 NumShots = 0;
+	while (bFireScheduled && FireTimeAccumulator >= TimeBetweenShots && NumShots < MaxShotsPerFrame)
+	{
+		FireTimeAccumulator -= TimeBetweenShots;
+		CurrentShotTimeOffset = FireTimeAccumulator;
+
+		/* HandleFiring schedules the next shot if we keep firing */
+		bFireScheduled = false;
+		HandleFiring();
+
+		NumShots++;
+	}
+	CurrentShotTimeOffset = 0.0f;
+
+	if (!bFireScheduled)
+	{
+		SetActorTickEnabled(false);
+		FireTimeAccumulator = 0.0f;
+	}
+	else if (NumShots >= MaxShotsPerFrame)
+	{
+		FireTimeAccumulator = FMath::Min(FireTimeAccumulator, TimeBetweenShots);
+	}
+}
+
+
+float AShooterWeapon::GetShotTimestamp() const
+{
+	return UShooterLagCompensationSubsystem::GetShotTimestamp(this) - CurrentShotTimeOffset;
+}
+
+
+void AShooterWeapon::FlushShotReports()
+{
+	if (bFireStatePending)
+	{
+		bFireStatePending = false;
+		ServerNotifyFired(LocalShotSequence);
+	}
+}
+
+
+bool AShooterWeapon::ServerNotifyFired_Validate(uint16 ShotSequence)
 {
 	return true;
 }
 
 
-void AShooterWeapon::ServerHandleFiring_Implementation()
+void AShooterWeapon::ServerNotifyFired_Implementation(uint16 ShotSequence)
+{
+	AcknowledgeShots(ShotSequence);
+}
+
+
+bool AShooterWeapon::ConsumeServerShot()
 {
 	const bool bShouldUpdateAmmo = (CurrentAmmoInClip > 0 && CanFire());
 
 	HandleFiring();
 
+	/* The shot is accounted for even if rejected, the client takes the server's ammo with the next correction */
+	AckedShotSequence++;
+	AcceptedShotMask = (AcceptedShotMask << 1) | (bShouldUpdateAmmo ? 1 : 0);
+
 	if (bShouldUpdateAmmo)
 	{
 		UseAmmo();
@@ -454,6 +626,59 @@ void AShooterWeapon::ServerHandleFiring_Implementation()
 		// Update firing FX on remote clients
 		BurstCounter++;
 	}
+
+	UpdateAuthoritativeAmmo(false);
+
+	return bShouldUpdateAmmo;
+}
+
+
+void AShooterWeapon::AcknowledgeShots(uint16 ShotSequence)
+{
+	const int32 NumShots = FMath::Min(GetUnacknowledgedShots(ShotSequence), ShooterWeaponNet::MaxShotsPerAck);
+	for (int32 i = 0; i < NumShots; i++)
+	{
+		ConsumeServerShot();
+	}
+
+	/* Forgive whatever is beyond the cap so the sequences line up again */
+	if (GetUnacknowledgedShots(ShotSequence) > 0)
+	{
+		AckedShotSequence = ShotSequence;
+		AcceptedShotMask = 0;
+		UpdateAuthoritativeAmmo(false);
+	}
+}
+
+
+bool AShooterWeapon::ClaimAcceptedShot(uint16 ShotSequence)
+{
+	const int32 Age = -GetUnacknowledgedShots(ShotSequence);
+	if (Age < 0 || Age >= 64)
+	{
+		return false;
+	}
+
+	const uint64 ShotBit = 1ull << Age;
+	if ((AcceptedShotMask & ShotBit) == 0)
+	{
+		return false;
+	}
+
+	AcceptedShotMask &= ~ShotBit;
+	return true;
+}
+
+
+int32 AShooterWeapon::GetUnacknowledgedShots(uint16 ShotSequence) const
+{
+	return (int16)(ShotSequence - AckedShotSequence);
+}
+
+
+bool AShooterWeapon::UsesBatchedShotReports() const
+{
+	return false;
 }
 
 
@@ -549,13 +774,18 @@ void AShooterWeapon::OnBurstStarted()
 {
 	// Start firing, can be delayed to satisfy TimeBetweenShots
 	const float GameTime = GetWorld()->GetTimeSeconds();
+	BurstStartFrame = GFrameCounter;
+
 	if (LastFireTime > 0 && TimeBetweenShots > 0.0f &&
 		LastFireTime + TimeBetweenShots > GameTime)
 	{
-		GetWorldTimerManager().SetTimer(TimerHandle_HandleFiring, this, &AShooterWeapon::HandleFiring, LastFireTime + TimeBetweenShots - GameTime, false);
+		/* The scheduler fires once the rest of the cooldown has passed */
+		FireTimeAccumulator = GameTime - LastFireTime;
+		ScheduleNextShot();
 	}
 	else
 	{
+		FireTimeAccumulator = 0.0f;
 		HandleFiring();
 	}
 }
@@ -570,7 +800,9 @@ void AShooterWeapon::OnBurstFinished()
 		StopSimulatingWeaponFire();
 	}
 
-	GetWorldTimerManager().ClearTimer(TimerHandle_HandleFiring);
+	bFireScheduled = false;
+	SetActorTickEnabled(false);
+	FireTimeAccumulator = 0.0f;
 	bRefiring = false;
 }
 
@@ -685,11 +917,49 @@ void AShooterWeapon::UseAmmo()
 }
 
 
+void AShooterWeapon::UpdateAuthoritativeAmmo(bool bImmediate)
+{
+	if (!HasAuthority())
+	{
+		return;
+	}
+
+	if (bImmediate)
+	{
+		GetWorldTimerManager().ClearTimer(TimerHandle_AmmoCorrection);
+		SendAmmoCorrection();
+	}
+	else if (!GetWorldTimerManager().IsTimerActive(TimerHandle_AmmoCorrection))
+	{
+		GetWorldTimerManager().SetTimer(TimerHandle_AmmoCorrection, this, &AShooterWeapon::SendAmmoCorrection, FMath::Max(0.01f, AmmoCorrectionInterval), false);
+	}
+}
+
+
+void AShooterWeapon::SendAmmoCorrection()
+{
+	AuthoritativeAmmo.Ammo = CurrentAmmo;
+	AuthoritativeAmmo.AmmoInClip = CurrentAmmoInClip;
+	AuthoritativeAmmo.ShotSequence = AckedShotSequence;
+}
+
+
+void AShooterWeapon::OnRep_AuthoritativeAmmo()
+{
+	/* Shots the server hasn't received yet are still in flight, keep them subtracted so the counter doesn't jump back */
+	const int32 PendingShots = FMath::Max(0, (int32)(int16)(LocalShotSequence - AuthoritativeAmmo.ShotSequence));
+
+	CurrentAmmo = FMath::Max(0, AuthoritativeAmmo.Ammo - PendingShots);
+	CurrentAmmoInClip = FMath::Max(0, AuthoritativeAmmo.AmmoInClip - PendingShots);
+}
+
+
 int32 AShooterWeapon::GiveAmmo(int32 AddAmount)
 {
 	const int32 MissingAmmo = FMath::Max(0, MaxAmmo - CurrentAmmo);
 	AddAmount = FMath::Min(AddAmount, MissingAmmo);
 	CurrentAmmo += AddAmount;
+	UpdateAuthoritativeAmmo(true);
 
 	/* Push reload request to client */
 	if (GetCurrentAmmoInClip() <= 0 && CanReload() &&
@@ -707,6 +977,7 @@ void AShooterWeapon::SetAmmoCount(int32 NewTotalAmount)
 {
 	CurrentAmmo = FMath::Min(MaxAmmo, NewTotalAmount);
 	CurrentAmmoInClip = FMath::Min(MaxAmmoPerClip, CurrentAmmo);
+	UpdateAuthoritativeAmmo(true);
 }
 
 
@@ -786,6 +1057,7 @@ void AShooterWeapon::ReloadWeapon()
 	if (ClipDelta > 0)
 	{
 		CurrentAmmoInClip += ClipDelta;
+		UpdateAuthoritativeAmmo(true);
 	}
 }
 
@@ -849,8 +1121,7 @@ void AShooterWeapon::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLi
 
 	DOREPLIFETIME(AShooterWeapon, MyPawn);
 
-	DOREPLIFETIME_CONDITION(AShooterWeapon, CurrentAmmo, COND_OwnerOnly);
-	DOREPLIFETIME_CONDITION(AShooterWeapon, CurrentAmmoInClip, COND_OwnerOnly);
+	DOREPLIFETIME_CONDITION(AShooterWeapon, AuthoritativeAmmo, COND_OwnerOnly);
 	DOREPLIFETIME_CONDITION(AShooterWeapon, BurstCounter, COND_SkipOwner);
 	DOREPLIFETIME_CONDITION(AShooterWeapon, bPendingReload, COND_SkipOwner);
 	
@@ -3,14 +3,121 @@
 
 #include "ShooterWeaponInstant.h"
 #include "ShooterImpactEffect.h"
+#include "World/ShooterEffectsSubsystem.h"
 #include "ShooterDamageType.h"
 #include "prototype/prototype.h"
 #include "PhysicalMaterials/PhysicalMaterial.h"
 #include "Net/UnrealNetwork.h"
 #include "Particles/ParticleSystemComponent.h"
 #include "Kismet/GameplayStatics.h"
+#include "World/ShooterLagCompensationSubsystem.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+#include "PhysicsEngine/SkeletalBodySetup.h"
+#include "TimerManager.h"
 
 
+static int32 BatchShotReports = 1;
+FAutoConsoleVariableRef CVARBatchShotReports(
+	TEXT("COOP.BatchShotReports"),
+	BatchShotReports,
+	TEXT("Send the shots of instant hit weapons to the server in one unreliable batch per frame instead of one reliable RPC per shot"),
+	ECVF_Cheat);
+
+
+namespace ShooterShotReports
+{
+	/* Flush early when a frame fires more shots than this (shotguns, frame hitches) */
+	const int32 MaxShotsPerBatch = 16;
+
+	/* Larger batches are rejected by validation */
+	const int32 MaxShotsPerBatchAccepted = 64;
+
+	/* Size of the replicated impact ring, must stay well below 128 for the sequence comparison */
+	const int32 NumReplicatedImpacts = 16;
+}
+
+
+void FShooterImpactArray::AddImpact(const FVector& ImpactPoint, const FVector& ImpactNormal, EPhysicalSurface SurfaceType)
+{
+	const int32 Slot = NextSequence % ShooterShotReports::NumReplicatedImpacts;
+	if (!Items.IsValidIndex(Slot))
+	{
+		Items.AddDefaulted();
+	}
+
+	FShooterImpactRecord& Record = Items[Slot];
+	Record.ImpactPoint = ImpactPoint;
+	Record.ImpactNormal = ImpactNormal;
+	Record.SurfaceType = SurfaceType;
+	Record.Sequence = NextSequence++;
+	MarkItemDirty(Record);
+}
+
+
+void FShooterImpactArray::PostReplicatedReceive(const FFastArraySerializer::FPostReplicatedReceiveParameters& Parameters)
+{
+	if (Owner)
+	{
+		Owner->OnImpactsReceived(Parameters.OldArraySize == 0);
+	}
+}
+
+
+bool FShooterShotRecord::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	/* Quantized vectors are clamped to their range, the flags only report that */
+	bool bOriginSuccess = true;
+	bool bShootDirSuccess = true;
+
+	Ar << Timestamp;
+	Origin.NetSerialize(Ar, Map, bOriginSuccess);
+	ShootDir.NetSerialize(Ar, Map, bShootDirSuccess);
+
+	uint8 bHit = HitDistance > 0;
+	uint8 bHasActor = HitActor != nullptr;
+	uint8 bHasBody = BodyIndex != INDEX_NONE;
+	uint8 bPellet = bExtraPellet;
+	Ar.SerializeBits(&bHit, 1);
+	Ar.SerializeBits(&bHasActor, 1);
+	Ar.SerializeBits(&bHasBody, 1);
+	Ar.SerializeBits(&bPellet, 1);
+	bExtraPellet = bPellet != 0;
+
+	if (Ar.IsLoading())
+	{
+		HitDistance = 0;
+		HitActor = nullptr;
+		BodyIndex = INDEX_NONE;
+	}
+
+	if (bHit)
+	{
+		bool bNormalSuccess = true;
+		Ar << HitDistance;
+		ImpactNormal.NetSerialize(Ar, Map, bNormalSuccess);
+		Ar << SurfaceType;
+	}
+
+	if (bHasActor)
+	{
+		/* The result only tells whether the actor is mapped. An actor destroyed before the batch arrived stays null, the hit counts as a world hit */
+		UObject* Object = HitActor;
+		Map->SerializeObject(Ar, AActor::StaticClass(), Object);
+		HitActor = Cast<AActor>(Object);
+	}
+
+	if (bHasBody)
+	{
+		uint8 PackedBodyIndex = (uint8)BodyIndex;
+		Ar << PackedBodyIndex;
+		BodyIndex = PackedBodyIndex;
+	}
+
+	bOutSuccess = true;
+	return true;
+}
+
 
 AShooterWeaponInstant::AShooterWeaponInstant()
 {
@@ -19,8 +126,20 @@ AShooterWeaponInstant::AShooterWeaponInstant()
 
 	AllowedViewDotHitDir = -1.0f;
 	ClientSideHitLeeway = 200.0f;
+	ClientSideMuzzleLeeway = 300.0f;
 	MinimumProjectileSpawnDistance = 800;
 	TracerRoundInterval = 3;
+
+	TraceMode = EWeaponTraceMode::Sync;
+	NumPellets = 1;
+	PelletSpread = 0.0f;
+
+	ReplicatedImpacts.Owner = this;
+	LastPlayedImpactSequence = INDEX_NONE;
+	ServerPelletsRemaining = 0;
+
+	AsyncTraceDelegate.BindUObject(this, &AShooterWeaponInstant::OnAsyncTraceComplete);
+	NextAsyncShotId = 0;
 }
 
 
@@ -28,6 +147,23 @@ void AShooterWeaponInstant::FireWeapon()
 {
 	const FVector AimDir = GetAdjustedAim();
 	const FVector CameraPos = GetCameraDamageStartLocation(AimDir);
+	const float ShotTimestamp = GetShotTimestamp();
+
+	if (TraceMode == EWeaponTraceMode::Async)
+	{
+		FireWeaponAsync(AimDir, CameraPos, ShotTimestamp);
+		return;
+	}
+
+	for (int32 PelletIndex = 0; PelletIndex < NumPellets; PelletIndex++)
+	{
+		FirePellet(GetPelletDirection(AimDir), CameraPos, PelletIndex, ShotTimestamp);
+	}
+}
+
+
+void AShooterWeaponInstant::FirePellet(const FVector& AimDir, const FVector& CameraPos, int32 PelletIndex, float ShotTimestamp)
+{
 	const FVector EndPos = CameraPos + (AimDir * WeaponRange);
 
 	/* Check for impact by tracing from the camera position */
@@ -50,7 +186,95 @@ void AShooterWeaponInstant::FireWeapon()
 		Impact.ImpactPoint = FVector_NetQuantize(EndPos);
 	}
 
-	ProcessInstantHit(Impact, MuzzleOrigin, AdjustedAimDir);
+	ProcessInstantHit(Impact, MuzzleOrigin, AdjustedAimDir, PelletIndex, ShotTimestamp);
+}
+
+
+FVector AShooterWeaponInstant::GetPelletDirection(const FVector& AimDir) const
+{
+	return PelletSpread > 0.0f ? FMath::VRandCone(AimDir, FMath::DegreesToRadians(PelletSpread * 0.5f)) : AimDir;
+}
+
+
+void AShooterWeaponInstant::FireWeaponAsync(const FVector& AimDir, const FVector& CameraPos, float ShotTimestamp)
+{
+	FPendingAsyncShot& Shot = PendingAsyncShots.AddDefaulted_GetRef();
+	Shot.ShotId = NextAsyncShotId++ & 0x00FFFFFF;
+	Shot.Timestamp = ShotTimestamp;
+	Shot.CameraPos = CameraPos;
+	Shot.MuzzleOrigin = GetMuzzleLocation();
+	Shot.NumPending = NumPellets;
+	Shot.Results.SetNum(NumPellets);
+
+	/* All pellets are submitted together, the crosshair trace is the only trace per pellet (no muzzle re-trace) */
+	for (int32 PelletIndex = 0; PelletIndex < NumPellets; PelletIndex++)
+	{
+		const FVector TraceEnd = CameraPos + (GetPelletDirection(AimDir) * WeaponRange);
+		Shot.TraceEnds.Add(TraceEnd);
+
+		AsyncWeaponTrace(CameraPos, TraceEnd, &AsyncTraceDelegate, (Shot.ShotId << 8) | (uint32)PelletIndex);
+	}
+}
+
+
+void AShooterWeaponInstant::OnAsyncTraceComplete(const FTraceHandle& Handle, FTraceDatum& Datum)
+{
+	const uint32 ShotId = Datum.UserData >> 8;
+	const int32 PelletIndex = Datum.UserData & 0xFF;
+
+	const int32 ShotIndex = PendingAsyncShots.IndexOfByPredicate([ShotId](const FPendingAsyncShot& Shot)
+	{
+		return Shot.ShotId == ShotId;
+	});
+
+	if (ShotIndex == INDEX_NONE || !PendingAsyncShots[ShotIndex].Results.IsValidIndex(PelletIndex))
+	{
+		return;
+	}
+
+	FPendingAsyncShot& Shot = PendingAsyncShots[ShotIndex];
+	if (Datum.OutHits.Num() > 0)
+	{
+		Shot.Results[PelletIndex] = Datum.OutHits[0];
+	}
+
+	if (--Shot.NumPending <= 0)
+	{
+		ResolveAsyncShot(Shot);
+		PendingAsyncShots.RemoveAt(ShotIndex);
+	}
+}
+
+
+void AShooterWeaponInstant::ResolveAsyncShot(FPendingAsyncShot& Shot)
+{
+	/* Unequipped or dropped while the traces were in flight */
+	if (MyPawn == nullptr)
+	{
+		return;
+	}
+
+	for (int32 PelletIndex = 0; PelletIndex < Shot.Results.Num(); PelletIndex++)
+	{
+		FHitResult& Impact = Shot.Results[PelletIndex];
+
+		/* Report the pellet as fired from the muzzle towards the crosshair impact, this is what the server validates */
+		FVector ShootDir;
+		if (Impact.bBlockingHit)
+		{
+			ShootDir = (Impact.ImpactPoint - Shot.MuzzleOrigin).GetSafeNormal();
+		}
+		else
+		{
+			ShootDir = (Shot.TraceEnds[PelletIndex] - Shot.MuzzleOrigin).GetSafeNormal();
+			Impact.ImpactPoint = FVector_NetQuantize(Shot.TraceEnds[PelletIndex]);
+		}
+
+		Impact.TraceStart = Shot.MuzzleOrigin;
+		Impact.TraceEnd = Shot.MuzzleOrigin + (ShootDir * WeaponRange);
+
+		ProcessInstantHit(Impact, Shot.MuzzleOrigin, ShootDir, PelletIndex, Shot.Timestamp);
+	}
 }
 
 
@@ -73,48 +297,84 @@ bool AShooterWeaponInstant::ShouldDealDamage(AActor* TestActor) const
 
 void AShooterWeaponInstant::DealDamage(const FHitResult& Impact, const FVector& ShootDir)
 {
-	float ActualHitDamage = HitDamage;
-
 	/* Handle special damage location on the zombie body (types are setup in the Physics Asset of the zombie */
-	UShooterDamageType* DmgType = Cast<UShooterDamageType>(DamageType->GetDefaultObject());
-	UPhysicalMaterial* PhysMat = Impact.PhysMaterial.Get();
-	if (PhysMat && DmgType)
+	const EPhysicalSurface SurfaceType = UPhysicalMaterial::DetermineSurfaceType(Impact.PhysMaterial.Get());
+
+	PointDamageEvent.HitInfo = Impact;
+	PointDamageEvent.ShotDirection = ShootDir;
+	PointDamageEvent.Damage = HitDamage * GetSurface(SurfaceType).DamageMultiplier;
+
+	Impact.GetActor()->TakeDamage(PointDamageEvent.Damage, PointDamageEvent, MyPawn->Controller, this);
+}
+
+
+void AShooterWeaponInstant::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	/* Flesh keeps the head and limb modifiers of the damage type unless the weapon overrides them */
+	const UShooterDamageType* DmgType = DamageType ? Cast<UShooterDamageType>(DamageType->GetDefaultObject()) : nullptr;
+
+	for (int32 SurfaceIndex = 0; SurfaceIndex < SurfaceType_Max; SurfaceIndex++)
 	{
-		if (PhysMat->SurfaceType == SURFACE_FLESHVULNERABLE)
+		FResolvedSurface& Surface = SurfaceTable[SurfaceIndex];
+		Surface.DamageMultiplier = 1.0f;
+		Surface.bIsFlesh = (SurfaceIndex == SURFACE_FLESHDEFAULT || SurfaceIndex == SURFACE_FLESHVULNERABLE);
+		Surface.ImpactTemplate = ImpactTemplate;
+
+		if (DmgType && SurfaceIndex == SURFACE_FLESHVULNERABLE)
 		{
-			ActualHitDamage *= DmgType->GetHeadDamageModifier();
+			Surface.DamageMultiplier = DmgType->GetHeadDamageModifier();
 		}
-		else if (PhysMat->SurfaceType == SURFACE_FLESHDEFAULT)
+		else if (DmgType && SurfaceIndex == SURFACE_FLESHDEFAULT)
 		{
-			ActualHitDamage *= DmgType->GetLimbDamageModifier();
+			Surface.DamageMultiplier = DmgType->GetLimbDamageModifier();
 		}
 	}
 
-	FPointDamageEvent PointDmg;
-	PointDmg.DamageTypeClass = DamageType;
-	PointDmg.HitInfo = Impact;
-	PointDmg.ShotDirection = ShootDir;
-	PointDmg.Damage = ActualHitDamage;
+	for (const FShooterSurfaceDamage& Override : SurfaceDamage)
+	{
+		FResolvedSurface& Surface = SurfaceTable[FMath::Clamp((int32)Override.SurfaceType, 0, (int32)SurfaceType_Max - 1)];
+		Surface.DamageMultiplier = Override.DamageMultiplier;
+		Surface.bIsFlesh = Override.bIsFlesh;
+		if (Override.ImpactTemplate)
+		{
+			Surface.ImpactTemplate = Override.ImpactTemplate;
+		}
+	}
 
-	Impact.GetActor()->TakeDamage(PointDmg.Damage, PointDmg, MyPawn->Controller, this);
+	PointDamageEvent.DamageTypeClass = DamageType;
 }
 
 
-void AShooterWeaponInstant::ProcessInstantHit(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir)
+void AShooterWeaponInstant::OnEnterPool()
+{
+	Super::OnEnterPool();
+
+	PendingShotRecords.Reset();
+	PendingAsyncShots.Reset();
+}
+
+
+void AShooterWeaponInstant::ProcessInstantHit(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir, int32 PelletIndex, float ShotTimestamp)
 {
 	if (MyPawn && MyPawn->IsLocallyControlled() && GetNetMode() == NM_Client)
 	{
+		if (UsesBatchedShotReports())
+		{
+			QueueShotRecord(Impact, Origin, ShootDir, PelletIndex, ShotTimestamp);
+		}
 		// If we are a client and hit something that is controlled by server
-		if (Impact.GetActor() && Impact.GetActor()->GetRemoteRole() == ROLE_Authority)
+		else if (Impact.GetActor() && Impact.GetActor()->GetRemoteRole() == ROLE_Authority)
 		{
 			// Notify the server of our local hit to validate and apply actual hit damage.
-			ServerNotifyHit(Impact, ShootDir);
+			ServerNotifyHit(Impact, ShootDir, ShotTimestamp);
 		}
 		else if (Impact.GetActor() == nullptr)
 		{
 			if (Impact.bBlockingHit)
 			{
-				ServerNotifyHit(Impact, ShootDir);
+				ServerNotifyHit(Impact, ShootDir, ShotTimestamp);
 			}
 			else
 			{
@@ -124,11 +384,11 @@ void AShooterWeaponInstant::ProcessInstantHit(const FHitResult& Impact, const FV
 	}
 
 	// Process a confirmed hit.
-	ProcessInstantHitConfirmed(Impact, Origin, ShootDir);
+	ProcessInstantHitConfirmed(Impact, Origin, ShootDir, UPhysicalMaterial::DetermineSurfaceType(Impact.PhysMaterial.Get()));
 }
 
 
-void AShooterWeaponInstant::ProcessInstantHitConfirmed(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir)
+void AShooterWeaponInstant::ProcessInstantHitConfirmed(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir, EPhysicalSurface SurfaceType)
 {
 	// Handle damage
 	if (ShouldDealDamage(Impact.GetActor()))
@@ -139,96 +399,161 @@ void AShooterWeaponInstant::ProcessInstantHitConfirmed(const FHitResult& Impact,
 	// Play FX on remote clients
 	if (HasAuthority())
 	{
-		HitImpactNotify = Impact.ImpactPoint;
+		ReplicatedImpacts.AddImpact(Impact.ImpactPoint, Impact.bBlockingHit ? Impact.ImpactNormal : FVector::ZeroVector, SurfaceType);
 	}
 
-	// Play FX locally
+	// Play FX locally, the muzzle trace of the shot is reused
 	if (GetNetMode() != NM_DedicatedServer)
 	{
-		SimulateInstantHit(Impact.ImpactPoint);
+		SpawnShotEffects(Impact, SurfaceType);
 	}
 }
 
 
-void AShooterWeaponInstant::SimulateInstantHit(const FVector& ImpactPoint)
+void AShooterWeaponInstant::SpawnShotEffects(const FHitResult& Impact, EPhysicalSurface SurfaceType)
 {
-	const FVector MuzzleOrigin = GetMuzzleLocation();
+	if (Impact.bBlockingHit)
+	{
+		SpawnImpactEffects(Impact, SurfaceType);
+	}
 
-	/* Adjust direction based on desired crosshair impact point and muzzle location */
-	const FVector AimDir = (ImpactPoint - MuzzleOrigin).GetSafeNormal();
+	SpawnTrailEffects(Impact.ImpactPoint);
+}
 
-	const FVector EndTrace = MuzzleOrigin + (AimDir * WeaponRange);
-	const FHitResult Impact = WeaponTrace(MuzzleOrigin, EndTrace);
 
-	if (Impact.bBlockingHit)
+void AShooterWeaponInstant::SimulateInstantHit(const FShooterImpactRecord& Record)
+{
+	const FVector ImpactNormal = Record.ImpactNormal;
+	if (ImpactNormal.IsNearlyZero())
 	{
-		SpawnImpactEffects(Impact);
-		SpawnTrailEffects(Impact.ImpactPoint);
+		SpawnTrailEffects(Record.ImpactPoint);
+		return;
 	}
-	else
+
+	FHitResult Impact(ForceInit);
+	Impact.bBlockingHit = true;
+	Impact.ImpactPoint = Record.ImpactPoint;
+	Impact.Location = Record.ImpactPoint;
+	Impact.ImpactNormal = ImpactNormal;
+	Impact.Normal = ImpactNormal;
+
+	/* Flesh moves, find the body around the impact so the decal sticks to it. Static surfaces don't need the component */
+	const EPhysicalSurface SurfaceType = (EPhysicalSurface)Record.SurfaceType;
+	if (GetSurface(SurfaceType).bIsFlesh)
 	{
-		SpawnTrailEffects(EndTrace);
+		const FHitResult BodyImpact = WeaponTrace(Record.ImpactPoint + ImpactNormal * 10.0f, Record.ImpactPoint - ImpactNormal * 10.0f);
+		if (BodyImpact.bBlockingHit)
+		{
+			Impact = BodyImpact;
+		}
 	}
+
+	SpawnImpactEffects(Impact, SurfaceType);
+	SpawnTrailEffects(Impact.ImpactPoint);
 }
 
 
-bool AShooterWeaponInstant::ServerNotifyHit_Validate(const FHitResult Impact, FVector_NetQuantizeNormal ShootDir)
+bool AShooterWeaponInstant::ServerNotifyHit_Validate(const FHitResult Impact, FVector_NetQuantizeNormal ShootDir, float ClientTimestamp)
 {
 	return true;
 }
 
 
-void AShooterWeaponInstant::ServerNotifyHit_Implementation(const FHitResult Impact, FVector_NetQuantizeNormal ShootDir)
+void AShooterWeaponInstant::ServerNotifyHit_Implementation(const FHitResult Impact, FVector_NetQuantizeNormal ShootDir, float ClientTimestamp)
+{
+	const FVector Origin = GetMuzzleLocation();
+
+	FHitResult ConfirmedImpact;
+	if (ValidateClientHit(Impact, Origin, ShootDir, ClientTimestamp, ConfirmedImpact))
+	{
+		ProcessInstantHitConfirmed(ConfirmedImpact, Origin, ShootDir, UPhysicalMaterial::DetermineSurfaceType(ConfirmedImpact.PhysMaterial.Get()));
+	}
+
+	// TODO: UE_LOG on failures & rejection
+}
+
+
+bool AShooterWeaponInstant::ValidateClientHit(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir, float ClientTimestamp, FHitResult& OutImpact) const
 {
 	// If we have an instigator, calculate the dot between the view and the shot
-	if (GetInstigator() && (Impact.GetActor() || Impact.bBlockingHit))
+	if (GetInstigator() == nullptr || (Impact.GetActor() == nullptr && !Impact.bBlockingHit))
 	{
-		const FVector Origin = GetMuzzleLocation();
-		const FVector ViewDir = (Impact.Location - Origin).GetSafeNormal();
+		return false;
+	}
 
-		const float ViewDotHitDir = FVector::DotProduct(GetInstigator()->GetViewRotation().Vector(), ViewDir);
-		if (ViewDotHitDir > AllowedViewDotHitDir)
-		{
-			// TODO: Check for weapon state
+	const FVector ViewDir = (Impact.Location - Origin).GetSafeNormal();
 
-			if (Impact.GetActor() == nullptr)
-			{
-				if (Impact.bBlockingHit)
-				{
-					ProcessInstantHitConfirmed(Impact, Origin, ShootDir);
-				}
-			}
-			// Assume it told the truth about static things because we don't move and the hit
-			// usually doesn't have significant gameplay implications
-			else if (Impact.GetActor()->IsRootComponentStatic() || Impact.GetActor()->IsRootComponentStationary())
-			{
-				ProcessInstantHitConfirmed(Impact, Origin, ShootDir);
-			}
-			else
-			{
-				const FBox HitBox = Impact.GetActor()->GetComponentsBoundingBox();
+	const float ViewDotHitDir = FVector::DotProduct(GetInstigator()->GetViewRotation().Vector(), ViewDir);
+	if (ViewDotHitDir <= AllowedViewDotHitDir)
+	{
+		return false;
+	}
 
-				FVector BoxExtent = 0.5 * (HitBox.Max - HitBox.Min);
-				BoxExtent *= ClientSideHitLeeway;
+	// TODO: Check for weapon state
 
-				BoxExtent.X = FMath::Max(20.0f, BoxExtent.X);
-				BoxExtent.Y = FMath::Max(20.0f, BoxExtent.Y);
-				BoxExtent.Z = FMath::Max(20.0f, BoxExtent.Z);
+	OutImpact = Impact;
 
-				const FVector BoxCenter = (HitBox.Min + HitBox.Max) * 0.5;
+	if (Impact.GetActor() == nullptr)
+	{
+		return true;
+	}
 
-				// If we are within client tolerance
-				if (FMath::Abs(Impact.Location.Z - BoxCenter.Z) < BoxExtent.Z &&
-					FMath::Abs(Impact.Location.X - BoxCenter.X) < BoxExtent.X &&
-					FMath::Abs(Impact.Location.Y - BoxCenter.Y) < BoxExtent.Y)
-				{
-					ProcessInstantHitConfirmed(Impact, Origin, ShootDir);
-				}
-			}
-		}
+	// Assume it told the truth about static things because we don't move and the hit
+	// usually doesn't have significant gameplay implications
+	if (Impact.GetActor()->IsRootComponentStatic() || Impact.GetActor()->IsRootComponentStationary())
+	{
+		return true;
 	}
 
-	// TODO: UE_LOG on failures & rejection
+	// Characters keep a hitbox history, re-trace against where they were when the client fired
+	UShooterLagCompensationSubsystem* LagCompensation = UShooterTickableWorldSubsystem::Get<UShooterLagCompensationSubsystem>(this);
+	if (LagCompensation && LagCompensation->IsTracked(Impact.GetActor()))
+	{
+		return ValidateRewoundHit(Impact, ShootDir, ClientTimestamp, OutImpact);
+	}
+
+	const FBox HitBox = Impact.GetActor()->GetComponentsBoundingBox();
+
+	FVector BoxExtent = 0.5 * (HitBox.Max - HitBox.Min);
+	BoxExtent *= ClientSideHitLeeway;
+
+	BoxExtent.X = FMath::Max(20.0f, BoxExtent.X);
+	BoxExtent.Y = FMath::Max(20.0f, BoxExtent.Y);
+	BoxExtent.Z = FMath::Max(20.0f, BoxExtent.Z);
+
+	const FVector BoxCenter = (HitBox.Min + HitBox.Max) * 0.5;
+
+	// If we are within client tolerance
+	return FMath::Abs(Impact.Location.Z - BoxCenter.Z) < BoxExtent.Z &&
+		FMath::Abs(Impact.Location.X - BoxCenter.X) < BoxExtent.X &&
+		FMath::Abs(Impact.Location.Y - BoxCenter.Y) < BoxExtent.Y;
+}
+
+
+bool AShooterWeaponInstant::ValidateRewoundHit(const FHitResult& Impact, const FVector& ShootDir, float ClientTimestamp, FHitResult& OutImpact) const
+{
+	UShooterLagCompensationSubsystem* LagCompensation = UShooterTickableWorldSubsystem::Get<UShooterLagCompensationSubsystem>(this);
+	AShooterBaseCharacter* HitCharacter = Cast<AShooterBaseCharacter>(Impact.GetActor());
+	if (LagCompensation == nullptr || HitCharacter == nullptr)
+	{
+		return false;
+	}
+
+	/* The shot has to come from (roughly) where our weapon is, we only trust the client on time, not on position */
+	const FVector TraceStart = Impact.TraceStart;
+	if (FVector::DistSquared(TraceStart, GetMuzzleLocation()) > FMath::Square(ClientSideMuzzleLeeway))
+	{
+		return false;
+	}
+
+	const FVector TraceEnd = TraceStart + (ShootDir * WeaponRange);
+	if (!LagCompensation->RewindTrace(HitCharacter, ClientTimestamp, TraceStart, TraceEnd, OutImpact))
+	{
+		return false;
+	}
+
+	/* Bone and physical material come from the server hitboxes so damage modifiers can't be picked by the client */
+	return true;
 }
 
 
@@ -239,12 +564,18 @@ bool AShooterWeaponInstant::ServerNotifyMiss_Validate(FVector_NetQuantizeNormal
 
 
 void AShooterWeaponInstant::ServerNotifyMiss_Implementation(FVector_NetQuantizeNormal ShootDir)
+{
+	ConfirmMiss(ShootDir);
+}
+
+
+void AShooterWeaponInstant::ConfirmMiss(const FVector& ShootDir)
 {
 	const FVector Origin = GetMuzzleLocation();
 	const FVector EndTrace = Origin + (ShootDir * WeaponRange);
 
 	// Play on remote clients
-	HitImpactNotify = EndTrace;
+	ReplicatedImpacts.AddImpact(EndTrace, FVector::ZeroVector, SurfaceType_Default);
 
 	if (GetNetMode() != NM_DedicatedServer)
 	{
@@ -253,20 +584,184 @@ void AShooterWeaponInstant::ServerNotifyMiss_Implementation(FVector_NetQuantizeN
 }
 
 
-void AShooterWeaponInstant::SpawnImpactEffects(const FHitResult& Impact)
+bool AShooterWeaponInstant::UsesBatchedShotReports() const
 {
-	if (ImpactTemplate && Impact.bBlockingHit)
+	return BatchShotReports != 0;
+}
+
+
+void AShooterWeaponInstant::QueueShotRecord(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir, int32 PelletIndex, float ShotTimestamp)
+{
+	FShooterShotRecord& Shot = PendingShotRecords.AddDefaulted_GetRef();
+	Shot.Timestamp = ShotTimestamp;
+	Shot.Origin = Origin;
+	Shot.ShootDir = ShootDir;
+	Shot.bExtraPellet = PelletIndex > 0;
+
+	if (Impact.bBlockingHit)
+	{
+		Shot.HitDistance = (uint16)FMath::Clamp(FMath::RoundToInt(FVector::Dist(Origin, Impact.ImpactPoint)), 1, (int32)MAX_uint16);
+		Shot.ImpactNormal = Impact.ImpactNormal;
+		Shot.SurfaceType = UPhysicalMaterial::DetermineSurfaceType(Impact.PhysMaterial.Get());
+
+		/* Actors we have authority over (torn off ragdolls) can't be referenced on the server, those count as world hits */
+		AActor* HitActor = Impact.GetActor();
+		if (HitActor && HitActor->GetRemoteRole() == ROLE_Authority)
+		{
+			Shot.HitActor = HitActor;
+
+			USkeletalMeshComponent* HitMesh = Cast<USkeletalMeshComponent>(Impact.GetComponent());
+			UPhysicsAsset* PhysicsAsset = HitMesh ? HitMesh->GetPhysicsAsset() : nullptr;
+			if (PhysicsAsset && Impact.BoneName != NAME_None)
+			{
+				const int32 BodyIndex = PhysicsAsset->FindBodyIndex(Impact.BoneName);
+				Shot.BodyIndex = BodyIndex <= MAX_uint8 ? BodyIndex : INDEX_NONE;
+			}
+		}
+	}
+
+	if (PendingShotRecords.Num() >= ShooterShotReports::MaxShotsPerBatch)
+	{
+		FlushShotReports();
+	}
+	else if (PendingShotRecords.Num() == 1)
+	{
+		GetWorldTimerManager().SetTimerForNextTick(this, &AShooterWeaponInstant::FlushShotReports);
+	}
+}
+
+
+void AShooterWeaponInstant::FlushShotReports()
+{
+	if (PendingShotRecords.Num() > 0)
+	{
+		ServerNotifyShots(PendingShotRecords, LocalShotSequence);
+		PendingShotRecords.Reset();
+	}
+
+	Super::FlushShotReports();
+}
+
+
+FHitResult AShooterWeaponInstant::MakeImpactFromShotRecord(const FShooterShotRecord& Shot) const
+{
+	FHitResult Impact(ForceInit);
+	Impact.TraceStart = Shot.Origin;
+	Impact.TraceEnd = Shot.Origin + (Shot.ShootDir * WeaponRange);
+
+	if (Shot.HitDistance == 0)
 	{
-		// TODO: Possible re-trace to get hit component that is lost during replication.
+		return Impact;
+	}
 
-		/* This function prepares an actor to spawn, but requires another call to finish the actual spawn progress. This allows manipulation of properties before entering into the level */
-		AShooterImpactEffect* EffectActor = GetWorld()->SpawnActorDeferred<AShooterImpactEffect>(ImpactTemplate, FTransform(Impact.ImpactPoint.Rotation(), Impact.ImpactPoint));
-		if (EffectActor)
+	Impact.bBlockingHit = true;
+	Impact.Distance = Shot.HitDistance;
+	Impact.Time = Impact.Distance / WeaponRange;
+	Impact.ImpactPoint = Shot.Origin + (Shot.ShootDir * Impact.Distance);
+	Impact.Location = Impact.ImpactPoint;
+	Impact.ImpactNormal = Shot.ImpactNormal.IsNearlyZero() ? -Shot.ShootDir : Shot.ImpactNormal;
+	Impact.Normal = Impact.ImpactNormal;
+	/* Null when the actor is gone on the server, the hit then only plays its impact like a world hit */
+	Impact.Actor = Shot.HitActor;
+
+	if (Shot.HitActor && Shot.BodyIndex != INDEX_NONE)
+	{
+		USkeletalMeshComponent* HitMesh = Shot.HitActor->FindComponentByClass<USkeletalMeshComponent>();
+		UPhysicsAsset* PhysicsAsset = HitMesh ? HitMesh->GetPhysicsAsset() : nullptr;
+		if (PhysicsAsset && PhysicsAsset->SkeletalBodySetups.IsValidIndex(Shot.BodyIndex))
 		{
-			EffectActor->SurfaceHit = Impact;
-			UGameplayStatics::FinishSpawningActor(EffectActor, FTransform(Impact.ImpactNormal.Rotation(), Impact.ImpactPoint));
+			const USkeletalBodySetup* BodySetup = PhysicsAsset->SkeletalBodySetups[Shot.BodyIndex];
+			Impact.Component = HitMesh;
+			Impact.BoneName = BodySetup->BoneName;
+			Impact.PhysMaterial = BodySetup->PhysMaterial;
 		}
 	}
+
+	return Impact;
+}
+
+
+bool AShooterWeaponInstant::ServerNotifyShots_Validate(const TArray<FShooterShotRecord>& Shots, uint16 ShotSequence)
+{
+	return Shots.Num() <= ShooterShotReports::MaxShotsPerBatchAccepted;
+}
+
+
+void AShooterWeaponInstant::ServerNotifyShots_Implementation(const TArray<FShooterShotRecord>& Shots, uint16 ShotSequence)
+{
+	/* All shots of a batch were fired within one client frame, the muzzle is looked up once */
+	const FVector Origin = GetMuzzleLocation();
+
+	int32 NumRounds = 0;
+	for (const FShooterShotRecord& Shot : Shots)
+	{
+		NumRounds += Shot.bExtraPellet ? 0 : 1;
+	}
+
+	/* Rounds of lost batches are charged first */
+	uint16 RoundSequence = (uint16)(ShotSequence - NumRounds);
+	AcknowledgeShots(RoundSequence);
+
+	for (const FShooterShotRecord& Shot : Shots)
+	{
+		if (Shot.bExtraPellet)
+		{
+			/* Never more pellets than the weapon fires per round */
+			if (ServerPelletsRemaining <= 0)
+			{
+				continue;
+			}
+
+			ServerPelletsRemaining--;
+		}
+		else
+		{
+			RoundSequence++;
+			ServerPelletsRemaining = 0;
+
+			/* Ammo, weapon state and remote fire FX, what ServerNotifyFired does for unbatched weapons. ServerStopFire may have charged the round already */
+			if (GetUnacknowledgedShots(RoundSequence) > 0)
+			{
+				ConsumeServerShot();
+			}
+
+			/* Hits only count for rounds the server accepted, once. Rejected, forgiven and already reported rounds are dropped */
+			if (!ClaimAcceptedShot(RoundSequence))
+			{
+				continue;
+			}
+
+			ServerPelletsRemaining = NumPellets - 1;
+		}
+
+		const FHitResult Impact = MakeImpactFromShotRecord(Shot);
+		if (!Impact.bBlockingHit)
+		{
+			ConfirmMiss(Shot.ShootDir);
+			continue;
+		}
+
+		FHitResult ConfirmedImpact;
+		if (ValidateClientHit(Impact, Origin, Shot.ShootDir, Shot.Timestamp, ConfirmedImpact))
+		{
+			/* Rewound character hits bring the server's body material, everything else uses the surface the client traced */
+			UPhysicalMaterial* PhysMaterial = ConfirmedImpact.PhysMaterial.Get();
+			const EPhysicalSurface SurfaceType = PhysMaterial ? UPhysicalMaterial::DetermineSurfaceType(PhysMaterial) : (EPhysicalSurface)Shot.SurfaceType;
+
+			ProcessInstantHitConfirmed(ConfirmedImpact, Origin, Shot.ShootDir, SurfaceType);
+		}
+	}
+}
+
+
+void AShooterWeaponInstant::SpawnImpactEffects(const FHitResult& Impact, EPhysicalSurface SurfaceType)
+{
+	UShooterEffectsSubsystem* Effects = UShooterTickableWorldSubsystem::Get<UShooterEffectsSubsystem>(this);
+	const TSubclassOf<AShooterImpactEffect> SurfaceImpactTemplate = GetSurface(SurfaceType).ImpactTemplate;
+	if (Effects && SurfaceImpactTemplate && Impact.bBlockingHit)
+	{
+		Effects->PlayImpactEffect(SurfaceImpactTemplate, Impact, SurfaceType);
+	}
 }
 
 
@@ -284,39 +779,73 @@ void AShooterWeaponInstant::SpawnTrailEffects(const FVector& EndPoint)
 		return;
 	}
 
+	UShooterEffectsSubsystem* Effects = UShooterTickableWorldSubsystem::Get<UShooterEffectsSubsystem>(this);
+	if (Effects == nullptr)
+	{
+		return;
+	}
+
+	AShooterCharacter* OwningPawn = GetPawnOwner();
+	const bool bFromRemotePlayer = !(OwningPawn && OwningPawn->IsLocallyControlled());
+
 	if (BulletsShotCount % TracerRoundInterval == 0)
 	{
-		if (TracerFX)
-		{
-			ShootDir.Normalize();
-			UGameplayStatics::SpawnEmitterAtLocation(this, TracerFX, Origin, ShootDir.Rotation());
-		}
+		Effects->PlayTracer(TracerFX, Origin, EndPoint, bFromRemotePlayer);
 	}
-	else
+	// Only create trails FX by other players.
+	else if (bFromRemotePlayer)
+	{
+		Effects->PlayTrail(TrailFX, TrailTargetParam, Origin, EndPoint, bFromRemotePlayer);
+	}
+}
+
+
+void AShooterWeaponInstant::OnImpactsReceived(bool bInitialUpdate)
+{
+	const FShooterImpactRecord* Newest = nullptr;
+	for (const FShooterImpactRecord& Record : ReplicatedImpacts.Items)
 	{
-		// Only create trails FX by other players.
-		AShooterCharacter* OwningPawn = GetPawnOwner();
-		if (OwningPawn && OwningPawn->IsLocallyControlled())
+		if (Newest == nullptr || (uint8)(Record.Sequence - Newest->Sequence) < 128)
 		{
-			return;
+			Newest = &Record;
 		}
+	}
+
+	if (Newest == nullptr)
+	{
+		return;
+	}
+
+	/* Became relevant while the ring was already filled, those impacts happened before we could see them */
+	if (bInitialUpdate && ReplicatedImpacts.Items.Num() > 1)
+	{
+		LastPlayedImpactSequence = Newest->Sequence;
+		return;
+	}
 
-		if (TrailFX)
+	/* Collect everything newer than the last played record and replay it in the order it was fired */
+	TArray<const FShooterImpactRecord*, TInlineAllocator<16>> NewRecords;
+	for (const FShooterImpactRecord& Record : ReplicatedImpacts.Items)
+	{
+		const uint8 Age = (uint8)(Newest->Sequence - Record.Sequence);
+		if (LastPlayedImpactSequence == INDEX_NONE || Age < (uint8)(Newest->Sequence - (uint8)LastPlayedImpactSequence))
 		{
-			UParticleSystemComponent* TrailPSC = UGameplayStatics::SpawnEmitterAtLocation(this, TrailFX, Origin);
-			if (TrailPSC)
-			{
-				TrailPSC->SetVectorParameter(TrailTargetParam, EndPoint);
-			}
+			NewRecords.Add(&Record);
 		}
 	}
-}
 
+	NewRecords.Sort([Newest](const FShooterImpactRecord& A, const FShooterImpactRecord& B)
+	{
+		return (uint8)(Newest->Sequence - A.Sequence) > (uint8)(Newest->Sequence - B.Sequence);
+	});
 
-void AShooterWeaponInstant::OnRep_HitLocation()
-{
 	// Played on all remote clients
-	SimulateInstantHit(HitImpactNotify);
+	for (const FShooterImpactRecord* Record : NewRecords)
+	{
+		SimulateInstantHit(*Record);
+	}
+
+	LastPlayedImpactSequence = Newest->Sequence;
 }
 
 
@@ -324,5 +853,5 @@ void AShooterWeaponInstant::GetLifetimeReplicatedProps(TArray< FLifetimeProperty
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME_CONDITION(AShooterWeaponInstant, HitImpactNotify, COND_SkipOwner);
+	DOREPLIFETIME_CONDITION(AShooterWeaponInstant, ReplicatedImpacts, COND_SkipOwner);
 }
\ No newline at end of file
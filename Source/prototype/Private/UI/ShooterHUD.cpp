@@ -34,7 +34,7 @@ void AShooterHUD::DrawCenterDot()
 	if (Pawn && Pawn->IsAlive())
 	{
 		// Boost size when hovering over a usable object.
-		AShooterUsableActor* Usable = Pawn->GetUsableInView();
+		AShooterUsableActor* Usable = Pawn->GetFocusedUsable();
 		if (Usable)
 		{
 			CenterDotScale *= 1.5f;
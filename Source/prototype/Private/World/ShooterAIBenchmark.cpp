@@ -0,0 +1,363 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "World/ShooterAIBenchmark.h"
+#include "NavigationSystem.h"
+#include "Misc/App.h"
+#include "Misc/Paths.h"
+#include "Misc/FileHelper.h"
+#include "../prototype.h"
+
+
+AShooterAIBenchmark::AShooterAIBenchmark()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+	/* Sample after all pawns and components ticked this frame */
+	PrimaryActorTick.TickGroup = TG_PostUpdateWork;
+
+	PopulationSizes = { 10, 50, 100, 250, 500 };
+	SpawnRadius = 5000.0f;
+	WarmupSeconds = 2.0f;
+	SampleSeconds = 10.0f;
+	FixedFrameRate = 30.0f;
+	bQuitWhenFinished = true;
+	ReportFileName = TEXT("AIScaling.csv");
+
+	TargetPawn = nullptr;
+	Phase = EPhase::Idle;
+	CurrentStep = 0;
+	PhaseTime = 0.0f;
+	SampledFrames = 0;
+	SampledFrameMs = 0.0;
+	LastFrameTime = 0.0;
+	bFailed = false;
+	bOverrodeTimeStep = false;
+	bPreviousUseFixedTimeStep = false;
+	PreviousFixedDeltaTime = 0.0;
+}
+
+
+void AShooterAIBenchmark::StartBenchmark()
+{
+	if (Phase != EPhase::Idle)
+	{
+		return;
+	}
+
+	Steps.Reset();
+	Results.Reset();
+	bFailed = false;
+
+	/* One curve per pawn class */
+	for (TSubclassOf<APawn> PawnClass : { ZombieClass, TrackerBotClass })
+	{
+		if (PawnClass == nullptr)
+		{
+			continue;
+		}
+
+		for (int32 Population : PopulationSizes)
+		{
+			FBenchmarkStep Step;
+			Step.PawnClass = PawnClass;
+			Step.Population = Population;
+			Steps.Add(Step);
+		}
+	}
+
+	if (Steps.Num() == 0)
+	{
+		UE_LOG(LogGame, Error, TEXT("AI benchmark has no pawn classes assigned."));
+		bFailed = true;
+		FinishBenchmark();
+		return;
+	}
+
+	if (FixedFrameRate > 0.0f)
+	{
+		bOverrodeTimeStep = true;
+		bPreviousUseFixedTimeStep = FApp::UseFixedTimeStep();
+		PreviousFixedDeltaTime = FApp::GetFixedDeltaTime();
+
+		FApp::SetUseFixedTimeStep(true);
+		FApp::SetFixedDeltaTime(1.0 / FixedFrameRate);
+	}
+
+	if (TargetPawnClass)
+	{
+		FActorSpawnParameters SpawnInfo;
+		SpawnInfo.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+		TargetPawn = GetWorld()->SpawnActor<APawn>(TargetPawnClass, GetActorLocation(), FRotator::ZeroRotator, SpawnInfo);
+	}
+
+	FShooterAIStats::SetEnabled(true);
+	SetActorTickEnabled(true);
+
+	CurrentStep = 0;
+	BeginStep();
+}
+
+
+bool AShooterAIBenchmark::HasFailed() const
+{
+	return bFailed;
+}
+
+
+void AShooterAIBenchmark::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	const double Now = FPlatformTime::Seconds();
+	const double FrameMs = (Now - LastFrameTime) * 1000.0;
+	LastFrameTime = Now;
+
+	double FrameStats[(int32)EShooterAIStat::Count];
+	FShooterAIStats::ConsumeFrame(FrameStats);
+
+	PhaseTime += DeltaSeconds;
+
+	if (Phase == EPhase::Warmup)
+	{
+		if (PhaseTime >= WarmupSeconds)
+		{
+			Phase = EPhase::Sampling;
+			PhaseTime = 0.0f;
+		}
+	}
+	else if (Phase == EPhase::Sampling)
+	{
+		for (int32 i = 0; i < (int32)EShooterAIStat::Count; i++)
+		{
+			SampledMs[i] += FrameStats[i];
+		}
+		SampledFrameMs += FrameMs;
+		SampledFrames++;
+
+		if (PhaseTime >= SampleSeconds)
+		{
+			EndStep();
+
+			CurrentStep++;
+			if (Steps.IsValidIndex(CurrentStep))
+			{
+				BeginStep();
+			}
+			else
+			{
+				FinishBenchmark();
+			}
+		}
+	}
+}
+
+
+void AShooterAIBenchmark::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	DestroyPopulation();
+	FShooterAIStats::SetEnabled(false);
+	RestoreTimeStep();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+
+void AShooterAIBenchmark::BeginStep()
+{
+	const FBenchmarkStep& Step = Steps[CurrentStep];
+	SpawnPopulation(Step.PawnClass, Step.Population);
+
+	Phase = EPhase::Warmup;
+	PhaseTime = 0.0f;
+	SampledFrames = 0;
+	SampledFrameMs = 0.0;
+	for (int32 i = 0; i < (int32)EShooterAIStat::Count; i++)
+	{
+		SampledMs[i] = 0.0;
+	}
+
+	/* Spawning is not part of the sampled cost */
+	double Discard[(int32)EShooterAIStat::Count];
+	FShooterAIStats::ConsumeFrame(Discard);
+	LastFrameTime = FPlatformTime::Seconds();
+}
+
+
+void AShooterAIBenchmark::EndStep()
+{
+	const FBenchmarkStep& Step = Steps[CurrentStep];
+	const int32 Frames = FMath::Max(1, SampledFrames);
+
+	FBenchmarkResult Result;
+	Result.Label = GetNameSafe(Step.PawnClass);
+	Result.Population = Step.Population;
+	Result.Frames = SampledFrames;
+	Result.AverageFrameMs = SampledFrameMs / Frames;
+	for (int32 i = 0; i < (int32)EShooterAIStat::Count; i++)
+	{
+		Result.AverageMs[i] = SampledMs[i] / Frames;
+	}
+	Result.bOverBudget = IsOverBudget(Result);
+	bFailed |= Result.bOverBudget;
+
+	UE_LOG(LogGame, Log, TEXT("AI benchmark %s x%d: Logic %.3f ms, Navigation %.3f ms, Movement %.3f ms, Perception %.3f ms, Frame %.3f ms%s"),
+		*Result.Label, Result.Population,
+		Result.AverageMs[(int32)EShooterAIStat::Logic], Result.AverageMs[(int32)EShooterAIStat::Navigation],
+		Result.AverageMs[(int32)EShooterAIStat::Movement], Result.AverageMs[(int32)EShooterAIStat::Perception],
+		Result.AverageFrameMs, Result.bOverBudget ? TEXT(" (OVER BUDGET)") : TEXT(""));
+
+	Results.Add(Result);
+
+	DestroyPopulation();
+}
+
+
+void AShooterAIBenchmark::FinishBenchmark()
+{
+	Phase = EPhase::Finished;
+	SetActorTickEnabled(false);
+	FShooterAIStats::SetEnabled(false);
+	RestoreTimeStep();
+
+	if (TargetPawn)
+	{
+		TargetPawn->Destroy();
+		TargetPawn = nullptr;
+	}
+
+	WriteReport();
+
+	if (bFailed)
+	{
+		UE_LOG(LogGame, Error, TEXT("AI benchmark failed, see %s"), *ReportFileName);
+	}
+
+	if (bQuitWhenFinished)
+	{
+		FPlatformMisc::RequestExitWithStatus(false, bFailed ? 1 : 0);
+	}
+}
+
+
+void AShooterAIBenchmark::RestoreTimeStep()
+{
+	if (!bOverrodeTimeStep)
+	{
+		return;
+	}
+
+	FApp::SetUseFixedTimeStep(bPreviousUseFixedTimeStep);
+	FApp::SetFixedDeltaTime(PreviousFixedDeltaTime);
+	bOverrodeTimeStep = false;
+}
+
+
+void AShooterAIBenchmark::SpawnPopulation(TSubclassOf<APawn> PawnClass, int32 Count)
+{
+	FActorSpawnParameters SpawnInfo;
+	SpawnInfo.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+	for (int32 i = 0; i < Count; i++)
+	{
+		const FRotator SpawnRotation(0.0f, FMath::FRandRange(-180.0f, 180.0f), 0.0f);
+		APawn* NewPawn = GetWorld()->SpawnActor<APawn>(PawnClass, FindSpawnLocation(), SpawnRotation, SpawnInfo);
+		if (NewPawn)
+		{
+			/* Spawned pawns are not auto-possessed by default */
+			if (NewPawn->Controller == nullptr)
+			{
+				NewPawn->SpawnDefaultController();
+			}
+
+			SpawnedPawns.Add(NewPawn);
+		}
+	}
+}
+
+
+void AShooterAIBenchmark::DestroyPopulation()
+{
+	for (APawn* SpawnedPawn : SpawnedPawns)
+	{
+		if (SpawnedPawn && !SpawnedPawn->IsPendingKill())
+		{
+			AController* SpawnedController = SpawnedPawn->Controller;
+			SpawnedPawn->Destroy();
+
+			if (SpawnedController)
+			{
+				SpawnedController->Destroy();
+			}
+		}
+	}
+
+	SpawnedPawns.Reset();
+}
+
+
+FVector AShooterAIBenchmark::FindSpawnLocation() const
+{
+	UNavigationSystemV1* NavSystem = UNavigationSystemV1::GetNavigationSystem(this);
+
+	FNavLocation NavLocation;
+	if (NavSystem && NavSystem->GetRandomReachablePointInRadius(GetActorLocation(), SpawnRadius, NavLocation))
+	{
+		/* Lift off the navmesh so capsules don't spawn inside the floor */
+		return NavLocation.Location + FVector(0.0f, 0.0f, 100.0f);
+	}
+
+	const FVector2D Offset = FMath::RandPointInCircle(SpawnRadius);
+	return GetActorLocation() + FVector(Offset.X, Offset.Y, 0.0f);
+}
+
+
+bool AShooterAIBenchmark::IsOverBudget(const FBenchmarkResult& Result) const
+{
+	const float Scale = Result.Population / 100.0f;
+	const float CategoryBudgets[(int32)EShooterAIStat::Count] =
+	{
+		Budget.LogicMsPer100,
+		Budget.NavigationMsPer100,
+		Budget.MovementMsPer100,
+		Budget.PerceptionMsPer100
+	};
+
+	for (int32 i = 0; i < (int32)EShooterAIStat::Count; i++)
+	{
+		/* A budget of 0 disables the check for that category */
+		if (CategoryBudgets[i] > 0.0f && Result.AverageMs[i] > CategoryBudgets[i] * Scale)
+		{
+			return true;
+		}
+	}
+
+	return Budget.MaxFrameMs > 0.0f && Result.AverageFrameMs > Budget.MaxFrameMs;
+}
+
+
+void AShooterAIBenchmark::WriteReport() const
+{
+	FString Report = TEXT("Class,Population,Frames");
+	for (int32 i = 0; i < (int32)EShooterAIStat::Count; i++)
+	{
+		Report += FString::Printf(TEXT(",%sMs"), FShooterAIStats::GetName((EShooterAIStat)i));
+	}
+	Report += TEXT(",FrameMs,Result\n");
+
+	for (const FBenchmarkResult& Result : Results)
+	{
+		Report += FString::Printf(TEXT("%s,%d,%d"), *Result.Label, Result.Population, Result.Frames);
+		for (int32 i = 0; i < (int32)EShooterAIStat::Count; i++)
+		{
+			Report += FString::Printf(TEXT(",%.4f"), Result.AverageMs[i]);
+		}
+		Report += FString::Printf(TEXT(",%.4f,%s\n"), Result.AverageFrameMs, Result.bOverBudget ? TEXT("FAIL") : TEXT("PASS"));
+	}
+
+	const FString ReportPath = FPaths::Combine(FPaths::ProfilingDir(), ReportFileName);
+	if (!FFileHelper::SaveStringToFile(Report, *ReportPath))
+	{
+		UE_LOG(LogGame, Warning, TEXT("Failed to write AI benchmark report to %s"), *ReportPath);
+	}
+}
@@ -2,7 +2,7 @@
 
 
 #include "World/ShooterCoopGameMode.h"
-#include "NavigationSystem.h"
+#include "World/ShooterNavQuerySubsystem.h"
 #include "ShooterPlayerState.h"
 #include "ShooterCharacter.h"
 #include "World/ShooterGameState.h"
@@ -51,56 +51,107 @@ void AShooterCoopGameMode::RestartPlayer(class AController* NewPlayer)
 	if (SpawnOrigin == FVector::ZeroVector)
 	{
 		Super::RestartPlayer(NewPlayer);
+		NotifyPlayerRestarted(NewPlayer);
 		return;
 	}
 
-	/* Get a point on the nav mesh near the other player */
-	FNavLocation StartLocation;
-	UNavigationSystemV1* NavSystem = UNavigationSystemV1::GetNavigationSystem(this);
-	if (NavSystem && NavSystem->GetRandomPointInNavigableRadius(SpawnOrigin, 250.0f, StartLocation))
+	UShooterNavQuerySubsystem* NavQuery = UShooterTickableWorldSubsystem::Get<UShooterNavQuerySubsystem>(this);
+	if (NavQuery == nullptr)
 	{
-		// Try to create a pawn to use of the default class for this player
-		if (NewPlayer->GetPawn() == nullptr && GetDefaultPawnClassForController(NewPlayer) != nullptr)
+		Super::RestartPlayer(NewPlayer);
+		NotifyPlayerRestarted(NewPlayer);
+		return;
+	}
+
+	/* Already waiting for a spawn location */
+	if (PendingRestarts.Contains(NewPlayer))
+	{
+		return;
+	}
+
+	/* Get a point on the nav mesh near the other player, the pawn is spawned once the query completes */
+	PendingRestarts.Add(NewPlayer);
+	NavQuery->RequestRandomPointInRadius(SpawnOrigin, 250.0f,
+		FShooterNavPointQueryDelegate::CreateUObject(this, &AShooterCoopGameMode::OnRestartLocationFound, TWeakObjectPtr<AController>(NewPlayer), StartRotation));
+}
+
+
+void AShooterCoopGameMode::OnRestartLocationFound(bool bSuccess, const FVector& StartLocation, TWeakObjectPtr<AController> Player, FRotator StartRotation)
+{
+	PendingRestarts.Remove(Player);
+
+	AController* NewPlayer = Player.Get();
+	if (NewPlayer == nullptr || NewPlayer->IsPendingKill())
+	{
+		return;
+	}
+
+	if (!bSuccess)
+	{
+		/* No navigable space near the team, use the PlayerStarts instead */
+		Super::RestartPlayer(NewPlayer);
+		NotifyPlayerRestarted(NewPlayer);
+		return;
+	}
+
+	RestartPlayerAtLocation(NewPlayer, StartLocation, StartRotation);
+}
+
+
+void AShooterCoopGameMode::RestartPlayerAtLocation(AController* NewPlayer, const FVector& StartLocation, const FRotator& StartRotation)
+{
+	// Try to create a pawn to use of the default class for this player
+	if (NewPlayer->GetPawn() == nullptr && GetDefaultPawnClassForController(NewPlayer) != nullptr)
+	{
+		FActorSpawnParameters SpawnInfo;
+		SpawnInfo.Instigator = GetInstigator();
+		APawn* ResultPawn = GetWorld()->SpawnActor<APawn>(GetDefaultPawnClassForController(NewPlayer), StartLocation, StartRotation, SpawnInfo);
+		if (ResultPawn == nullptr)
 		{
-			FActorSpawnParameters SpawnInfo;
-			SpawnInfo.Instigator = GetInstigator();
-			APawn* ResultPawn = GetWorld()->SpawnActor<APawn>(GetDefaultPawnClassForController(NewPlayer), StartLocation.Location, StartRotation, SpawnInfo);
-			if (ResultPawn == nullptr)
-			{
-				UE_LOG(LogGameMode, Warning, TEXT("Couldn't spawn Pawn of type %s at %s"), *GetNameSafe(DefaultPawnClass), &StartLocation.Location);
-			}
-			NewPlayer->SetPawn(ResultPawn);
+			UE_LOG(LogGameMode, Warning, TEXT("Couldn't spawn Pawn of type %s at %s"), *GetNameSafe(DefaultPawnClass), *StartLocation.ToString());
 		}
+		NewPlayer->SetPawn(ResultPawn);
+	}
+
+	if (NewPlayer->GetPawn() == nullptr)
+	{
+		NewPlayer->FailedToSpawnPawn();
+	}
+	else
+	{
+		NewPlayer->Possess(NewPlayer->GetPawn());
 
+		// If the Pawn is destroyed as part of possession we have to abort
 		if (NewPlayer->GetPawn() == nullptr)
 		{
 			NewPlayer->FailedToSpawnPawn();
 		}
 		else
 		{
-			NewPlayer->Possess(NewPlayer->GetPawn());
+			// Set initial control rotation to player start's rotation
+			NewPlayer->ClientSetRotation(NewPlayer->GetPawn()->GetActorRotation(), true);
 
-			// If the Pawn is destroyed as part of possession we have to abort
-			if (NewPlayer->GetPawn() == nullptr)
-			{
-				NewPlayer->FailedToSpawnPawn();
-			}
-			else
-			{
-				// Set initial control rotation to player start's rotation
-				NewPlayer->ClientSetRotation(NewPlayer->GetPawn()->GetActorRotation(), true);
+			FRotator NewControllerRot = StartRotation;
+			NewControllerRot.Roll = 0.f;
+			NewPlayer->SetControlRotation(NewControllerRot);
 
-				FRotator NewControllerRot = StartRotation;
-				NewControllerRot.Roll = 0.f;
-				NewPlayer->SetControlRotation(NewControllerRot);
-
-				SetPlayerDefaults(NewPlayer->GetPawn());
-			}
+			SetPlayerDefaults(NewPlayer->GetPawn());
+			NotifyPlayerRestarted(NewPlayer);
 		}
 	}
 }
 
 
+void AShooterCoopGameMode::NotifyPlayerRestarted(AController* NewPlayer)
+{
+	AShooterPlayerController* MyController = Cast<AShooterPlayerController>(NewPlayer);
+	if (MyController && MyController->GetPawn())
+	{
+		MyController->ClientHUDStateChanged(EHUDState::Playing);
+	}
+}
+
+
 void AShooterCoopGameMode::OnNightEnded()
 {
 	/* Respawn spectating players that died during the night */
@@ -112,8 +163,8 @@ void AShooterCoopGameMode::OnNightEnded()
 		{
 			if (MyController->PlayerState->IsSpectator())
 			{
+				/* The HUD switches back to playing once the pawn is spawned, which may take a navigation query */
 				RestartPlayer(MyController);
-				MyController->ClientHUDStateChanged(EHUDState::Playing);
 			}
 			else
 			{
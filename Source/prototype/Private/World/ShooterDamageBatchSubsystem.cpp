@@ -0,0 +1,109 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "World/ShooterDamageBatchSubsystem.h"
+#include "ShooterBaseCharacter.h"
+#include "Engine/World.h"
+
+
+static int32 CoalesceDamage = 1;
+FAutoConsoleVariableRef CVARCoalesceDamage(
+	TEXT("COOP.CoalesceDamage"),
+	CoalesceDamage,
+	TEXT("Sum up the damage a character takes within a frame before applying it, 0 applies every hit right away"),
+	ECVF_Cheat);
+
+
+void FShooterQueuedHit::SetDamageEvent(const FDamageEvent& DamageEvent)
+{
+	DamageEventClassID = DamageEvent.GetTypeID();
+	switch (DamageEventClassID)
+	{
+	case FPointDamageEvent::ClassID:
+		PointDamageEvent = *((FPointDamageEvent const*)(&DamageEvent));
+		break;
+	case FRadialDamageEvent::ClassID:
+		RadialDamageEvent = *((FRadialDamageEvent const*)(&DamageEvent));
+		break;
+	default:
+		GeneralDamageEvent = DamageEvent;
+	}
+}
+
+
+const FDamageEvent& FShooterQueuedHit::GetDamageEvent() const
+{
+	switch (DamageEventClassID)
+	{
+	case FPointDamageEvent::ClassID:
+		return PointDamageEvent;
+	case FRadialDamageEvent::ClassID:
+		return RadialDamageEvent;
+	default:
+		return GeneralDamageEvent;
+	}
+}
+
+
+bool FShooterQueuedHit::IsSameSource(const FShooterQueuedHit& Other) const
+{
+	return EventInstigator == Other.EventInstigator && DamageCauser == Other.DamageCauser && GetDamageEvent().DamageTypeClass == Other.GetDamageEvent().DamageTypeClass;
+}
+
+
+bool UShooterDamageBatchSubsystem::QueueDamage(AShooterBaseCharacter* Victim, float Damage, const FDamageEvent& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
+{
+	if (!CoalesceDamage || Victim == nullptr)
+	{
+		return false;
+	}
+
+	/* Only a handful of characters are hit within one frame */
+	FPendingVictim* Pending = PendingVictims.FindByPredicate([Victim](const FPendingVictim& Entry) { return Entry.Victim == Victim; });
+	if (Pending == nullptr)
+	{
+		Pending = &PendingVictims.AddDefaulted_GetRef();
+		Pending->Victim = Victim;
+	}
+
+	FShooterQueuedHit& Hit = Pending->Hits.AddDefaulted_GetRef();
+	Hit.Damage = Damage;
+	Hit.EventInstigator = EventInstigator;
+	Hit.DamageCauser = DamageCauser;
+	Hit.SetDamageEvent(DamageEvent);
+
+	return true;
+}
+
+
+void UShooterDamageBatchSubsystem::Tick(float DeltaTime)
+{
+	/* Deaths and hit reactions may deal damage again, that damage is queued for the next frame */
+	Swap(PendingVictims, FlushingVictims);
+
+	for (const FPendingVictim& Pending : FlushingVictims)
+	{
+		AShooterBaseCharacter* Victim = Pending.Victim.Get();
+		if (Victim && !Victim->IsPendingKill())
+		{
+			Victim->ApplyQueuedDamage(Pending.Hits);
+		}
+	}
+
+	FlushingVictims.Reset();
+}
+
+
+bool UShooterDamageBatchSubsystem::HasPendingWork() const
+{
+	return PendingVictims.Num() > 0;
+}
+
+
+void UShooterDamageBatchSubsystem::Deinitialize()
+{
+	PendingVictims.Reset();
+	FlushingVictims.Reset();
+
+	Super::Deinitialize();
+}
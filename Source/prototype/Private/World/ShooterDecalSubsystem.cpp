@@ -0,0 +1,191 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "World/ShooterDecalSubsystem.h"
+#include "Components/DecalComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Engine/World.h"
+
+
+static float DecalBudgetScale = 1.0f;
+FAutoConsoleVariableRef CVARDecalBudgetScale(
+	TEXT("COOP.DecalBudgetScale"),
+	DecalBudgetScale,
+	TEXT("Multiplier for the number of decals kept per category, applied when a category is first used"),
+	ECVF_Cheat);
+
+
+namespace ShooterDecals
+{
+	struct FCategorySettings
+	{
+		int32 Capacity;
+
+		/* Decals smaller than this on screen fade out, so distant decals stop drawing */
+		float FadeScreenSize;
+	};
+
+	/* Indexed by EShooterDecalCategory */
+	const FCategorySettings Categories[(int32)EShooterDecalCategory::MAX] =
+	{
+		/* BulletHole */		{ 64, 0.005f },
+		/* Footprint */			{ 48, 0.01f },
+	};
+
+	const float FadeDuration = 0.5f;
+
+	/* Margin added to the view cone, decals just outside the screen edge are still placed */
+	const float ViewAngleMargin = 10.0f;
+}
+
+
+UDecalComponent* UShooterDecalSubsystem::SpawnDecal(EShooterDecalCategory Category, UMaterialInterface* Material, const FVector& Size, const FVector& Location, const FRotator& Rotation,
+	float LifeSpan, USceneComponent* AttachTo, FName AttachBoneName)
+{
+	UWorld* World = GetWorld();
+	if (Material == nullptr || World->GetNetMode() == NM_DedicatedServer || !IsInView(Location, Size.GetMax()))
+	{
+		return nullptr;
+	}
+
+	const int32 CategoryIndex = (int32)Category;
+	if (Rings.Num() <= CategoryIndex || Rings[CategoryIndex].Components.Num() == 0)
+	{
+		AllocateRing(Category);
+	}
+
+	/* Recycle the oldest decal of the category */
+	FShooterDecalRing& Ring = Rings[CategoryIndex];
+	const int32 Slot = Ring.Next;
+	Ring.Next = (Ring.Next + 1) % Ring.Components.Num();
+
+	UDecalComponent* DecalComp = Ring.Components[Slot];
+	DecalComp->DetachFromComponent(FDetachmentTransformRules::KeepWorldTransform);
+	DecalComp->SetDecalMaterial(Material);
+	DecalComp->DecalSize = Size;
+	DecalComp->SetWorldLocationAndRotation(Location, Rotation);
+
+	if (AttachTo)
+	{
+		DecalComp->AttachToComponent(AttachTo, FAttachmentTransformRules::KeepWorldTransform, AttachBoneName);
+	}
+
+	/* The fade restarts with the new render state. The lifespan timer of the fade would destroy the component, it is recycled instead */
+	DecalComp->SetFadeOut(FMath::Max(0.0f, LifeSpan - ShooterDecals::FadeDuration), FMath::Min(LifeSpan, ShooterDecals::FadeDuration), false);
+	DecalComp->SetLifeSpan(0.0f);
+	DecalComp->SetVisibility(true);
+	DecalComp->MarkRenderStateDirty();
+
+	Ring.ExpireTimes[Slot] = World->GetTimeSeconds() + LifeSpan;
+
+	return DecalComp;
+}
+
+
+bool UShooterDecalSubsystem::IsInView(const FVector& Location, float Radius) const
+{
+	/* No local player known yet, don't skip anything */
+	if (Viewers.Num() == 0)
+	{
+		return true;
+	}
+
+	for (const FViewer& Viewer : Viewers)
+	{
+		const FVector ToLocation = Location - Viewer.Location;
+		const float Distance = ToLocation.Size();
+
+		if (Distance <= Radius || (ToLocation | Viewer.Direction) >= Distance * Viewer.CosHalfFOV - Radius)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+void UShooterDecalSubsystem::AllocateRing(EShooterDecalCategory Category)
+{
+	if (Rings.Num() < (int32)EShooterDecalCategory::MAX)
+	{
+		Rings.SetNum((int32)EShooterDecalCategory::MAX);
+	}
+
+	const ShooterDecals::FCategorySettings& Settings = ShooterDecals::Categories[(int32)Category];
+	const int32 Capacity = FMath::Max(1, FMath::CeilToInt(Settings.Capacity * DecalBudgetScale));
+
+	FShooterDecalRing& Ring = Rings[(int32)Category];
+	Ring.Components.Reset(Capacity);
+	Ring.ExpireTimes.Init(MAX_flt, Capacity);
+	Ring.Next = 0;
+
+	for (int32 i = 0; i < Capacity; i++)
+	{
+		Ring.Components.Add(CreatePooledComponent<UDecalComponent>([&Settings](UDecalComponent* DecalComp)
+		{
+			DecalComp->SetFadeScreenSize(Settings.FadeScreenSize);
+			DecalComp->SetVisibility(false);
+		}));
+	}
+}
+
+
+void UShooterDecalSubsystem::UpdateViewers()
+{
+	Viewers.Reset();
+
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		APlayerController* PC = It->Get();
+		if (PC == nullptr || !PC->IsLocalController() || PC->PlayerCameraManager == nullptr)
+		{
+			continue;
+		}
+
+		/* Horizontal field of view plus a margin roughly covers the corners of a wide screen */
+		const float HalfFOV = FMath::Min(89.0f, PC->PlayerCameraManager->GetFOVAngle() * 0.5f + ShooterDecals::ViewAngleMargin);
+
+		FViewer Viewer;
+		Viewer.Location = PC->PlayerCameraManager->GetCameraLocation();
+		Viewer.Direction = PC->PlayerCameraManager->GetCameraRotation().Vector();
+		Viewer.CosHalfFOV = FMath::Cos(FMath::DegreesToRadians(HalfFOV));
+		Viewers.Add(Viewer);
+	}
+}
+
+
+void UShooterDecalSubsystem::Tick(float DeltaTime)
+{
+	UpdateViewers();
+
+	/* Faded decals are hidden so they stop costing a draw until their slot is reused */
+	const float Now = GetWorld()->GetTimeSeconds();
+	for (FShooterDecalRing& Ring : Rings)
+	{
+		for (int32 Slot = 0; Slot < Ring.Components.Num(); Slot++)
+		{
+			if (Ring.ExpireTimes[Slot] <= Now)
+			{
+				Ring.ExpireTimes[Slot] = MAX_flt;
+				Ring.Components[Slot]->SetVisibility(false);
+			}
+		}
+	}
+}
+
+
+bool UShooterDecalSubsystem::HasPendingWork() const
+{
+	return GetWorld()->GetNetMode() != NM_DedicatedServer;
+}
+
+
+void UShooterDecalSubsystem::Deinitialize()
+{
+	Rings.Reset();
+	Viewers.Reset();
+
+	Super::Deinitialize();
+}
@@ -0,0 +1,247 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "World/ShooterEffectsSubsystem.h"
+#include "World/ShooterSignificanceSubsystem.h"
+#include "World/ShooterDecalSubsystem.h"
+#include "ShooterImpactEffect.h"
+#include "Particles/ParticleSystemComponent.h"
+#include "Kismet/GameplayStatics.h"
+#include "Sound/SoundCue.h"
+#include "Engine/World.h"
+
+
+static int32 MaxImpactEffectsPerFrame = 24;
+FAutoConsoleVariableRef CVARMaxImpactEffectsPerFrame(
+	TEXT("COOP.MaxImpactEffectsPerFrame"),
+	MaxImpactEffectsPerFrame,
+	TEXT("Impacts beyond this number within one frame play no effects at all"),
+	ECVF_Cheat);
+
+static int32 MaxTrailEffectsPerFrame = 16;
+FAutoConsoleVariableRef CVARMaxTrailEffectsPerFrame(
+	TEXT("COOP.MaxTrailEffectsPerFrame"),
+	MaxTrailEffectsPerFrame,
+	TEXT("Tracers and bullet trails beyond this number within one frame are not shown"),
+	ECVF_Cheat);
+
+
+namespace ShooterEffects
+{
+	const int32 ParticlePoolSize = 32;
+
+	const int32 TrailPoolSize = 32;
+}
+
+
+void UShooterEffectsSubsystem::PlayImpactEffect(TSubclassOf<AShooterImpactEffect> Template, const FHitResult& Impact, EPhysicalSurface SurfaceType)
+{
+	if (Template == nullptr || NumImpactsThisFrame >= MaxImpactEffectsPerFrame)
+	{
+		return;
+	}
+
+	/* Culled: nothing, Low: sound only, Medium: particles and a short lived decal, High: everything */
+	EShooterSignificance Significance = EShooterSignificance::High;
+	UShooterSignificanceSubsystem* SignificanceSubsystem = UShooterTickableWorldSubsystem::Get<UShooterSignificanceSubsystem>(this);
+	if (SignificanceSubsystem)
+	{
+		Significance = SignificanceSubsystem->ClaimEffectSignificance(EShooterSignificanceCategory::ImpactEffect, Impact.ImpactPoint);
+	}
+
+	if (Significance == EShooterSignificance::Culled)
+	{
+		return;
+	}
+
+	NumImpactsThisFrame++;
+
+	if (ParticlePool.Num() == 0)
+	{
+		AllocatePools();
+	}
+
+	const FImpactEffectTable& Table = GetImpactTable(Template);
+	const int32 SurfaceIndex = FMath::Clamp((int32)SurfaceType, 0, (int32)SurfaceType_Max - 1);
+
+	UParticleSystem* ImpactFX = Table.FX[SurfaceIndex];
+	if (ImpactFX && Significance >= EShooterSignificance::Medium)
+	{
+		UParticleSystemComponent* ParticleComp = GetNextParticleComponent();
+		if (ParticleComp->Template != ImpactFX)
+		{
+			ParticleComp->SetTemplate(ImpactFX);
+		}
+		ParticleComp->SetWorldLocationAndRotation(Impact.ImpactPoint, Impact.ImpactNormal.Rotation());
+		ParticleComp->Activate(true);
+	}
+
+	USoundCue* ImpactSound = Table.Sounds[SurfaceIndex];
+	if (ImpactSound)
+	{
+		UGameplayStatics::PlaySoundAtLocation(this, ImpactSound, Impact.ImpactPoint);
+	}
+
+	if (Table.DecalMaterial && Significance >= EShooterSignificance::Medium)
+	{
+		const float LifeSpan = Significance == EShooterSignificance::High ? Table.DecalLifeSpan : Table.DecalLifeSpan * 0.25f;
+
+		/* Inverse to point towards the wall. Invert to get the correct orientation of the decal (pointing into the surface instead of away, messing with the normals, and lighting) */
+		FRotator RandomDecalRotation = (-Impact.ImpactNormal.GetSafeNormal()).ToOrientationRotator();
+		RandomDecalRotation.Roll = FMath::FRandRange(-180.0f, 180.0f);
+
+		/* Follow moving surfaces, replicated impacts on static surfaces don't know the component and don't need it */
+		USceneComponent* AttachTo = nullptr;
+		if (Impact.Component.IsValid() && Impact.Component->Mobility == EComponentMobility::Movable)
+		{
+			AttachTo = Impact.Component.Get();
+		}
+
+		UShooterDecalSubsystem* DecalSubsystem = UShooterTickableWorldSubsystem::Get<UShooterDecalSubsystem>(this);
+		if (DecalSubsystem)
+		{
+			DecalSubsystem->SpawnDecal(EShooterDecalCategory::BulletHole, Table.DecalMaterial, FVector(Table.DecalSize), Impact.ImpactPoint, RandomDecalRotation,
+				LifeSpan, AttachTo, Impact.BoneName);
+		}
+	}
+}
+
+
+void UShooterEffectsSubsystem::PlayTracer(UParticleSystem* Template, const FVector& Origin, const FVector& EndPoint, bool bFromRemotePlayer)
+{
+	UParticleSystemComponent* ParticleComp = ClaimTrailComponent(Template, Origin, EndPoint, bFromRemotePlayer);
+	if (ParticleComp)
+	{
+		ParticleComp->SetWorldLocationAndRotation(Origin, (EndPoint - Origin).Rotation());
+		ParticleComp->Activate(true);
+	}
+}
+
+
+void UShooterEffectsSubsystem::PlayTrail(UParticleSystem* Template, FName TrailTargetParam, const FVector& Origin, const FVector& EndPoint, bool bFromRemotePlayer)
+{
+	UParticleSystemComponent* ParticleComp = ClaimTrailComponent(Template, Origin, EndPoint, bFromRemotePlayer);
+	if (ParticleComp)
+	{
+		ParticleComp->SetWorldLocationAndRotation(Origin, FRotator::ZeroRotator);
+		ParticleComp->SetVectorParameter(TrailTargetParam, EndPoint);
+		ParticleComp->Activate(true);
+	}
+}
+
+
+UParticleSystemComponent* UShooterEffectsSubsystem::ClaimTrailComponent(UParticleSystem* Template, const FVector& Origin, const FVector& EndPoint, bool bFromRemotePlayer)
+{
+	if (Template == nullptr || NumTrailsThisFrame >= MaxTrailEffectsPerFrame)
+	{
+		return nullptr;
+	}
+
+	/* The own shots of a local player are always shown, everyone else's only while the trail passes close to a viewer */
+	if (bFromRemotePlayer)
+	{
+		UShooterSignificanceSubsystem* SignificanceSubsystem = UShooterTickableWorldSubsystem::Get<UShooterSignificanceSubsystem>(this);
+		if (SignificanceSubsystem && SignificanceSubsystem->ClaimEffectSignificance(EShooterSignificanceCategory::WeaponTrail, Origin, EndPoint) < EShooterSignificance::Medium)
+		{
+			return nullptr;
+		}
+	}
+
+	NumTrailsThisFrame++;
+
+	if (TrailPool.Num() == 0)
+	{
+		AllocatePools();
+	}
+
+	/* The oldest trail is cut off if it is still playing */
+	UParticleSystemComponent* ParticleComp = TrailPool[NextTrail];
+	NextTrail = (NextTrail + 1) % TrailPool.Num();
+
+	if (ParticleComp->Template != Template)
+	{
+		ParticleComp->SetTemplate(Template);
+	}
+
+	return ParticleComp;
+}
+
+
+const UShooterEffectsSubsystem::FImpactEffectTable& UShooterEffectsSubsystem::GetImpactTable(TSubclassOf<AShooterImpactEffect> Template)
+{
+	if (const FImpactEffectTable* Table = ImpactTables.Find(Template))
+	{
+		return *Table;
+	}
+
+	/* Resolve the surface switch of the template once instead of per impact */
+	const AShooterImpactEffect* Defaults = Template->GetDefaultObject<AShooterImpactEffect>();
+
+	FImpactEffectTable& Table = ImpactTables.Add(Template);
+	for (int32 SurfaceIndex = 0; SurfaceIndex < SurfaceType_Max; SurfaceIndex++)
+	{
+		Table.FX[SurfaceIndex] = Defaults->GetImpactFX((EPhysicalSurface)SurfaceIndex);
+		Table.Sounds[SurfaceIndex] = Defaults->GetImpactSound((EPhysicalSurface)SurfaceIndex);
+	}
+	Table.DecalMaterial = Defaults->DecalMaterial;
+	Table.DecalSize = Defaults->DecalSize;
+	Table.DecalLifeSpan = Defaults->DecalLifeSpan;
+
+	return Table;
+}
+
+
+void UShooterEffectsSubsystem::AllocatePools()
+{
+	for (int32 i = 0; i < ShooterEffects::ParticlePoolSize + ShooterEffects::TrailPoolSize; i++)
+	{
+		UParticleSystemComponent* ParticleComp = CreatePooledComponent<UParticleSystemComponent>([](UParticleSystemComponent* Comp)
+		{
+			Comp->bAutoActivate = false;
+			Comp->bAutoDestroy = false;
+			Comp->SetUsingAbsoluteLocation(true);
+			Comp->SetUsingAbsoluteRotation(true);
+		});
+
+		if (i < ShooterEffects::ParticlePoolSize)
+		{
+			ParticlePool.Add(ParticleComp);
+		}
+		else
+		{
+			TrailPool.Add(ParticleComp);
+		}
+	}
+}
+
+
+UParticleSystemComponent* UShooterEffectsSubsystem::GetNextParticleComponent()
+{
+	/* The oldest effect is cut off if it is still playing */
+	UParticleSystemComponent* ParticleComp = ParticlePool[NextParticle];
+	NextParticle = (NextParticle + 1) % ParticlePool.Num();
+	return ParticleComp;
+}
+
+
+void UShooterEffectsSubsystem::Tick(float DeltaTime)
+{
+	NumImpactsThisFrame = 0;
+	NumTrailsThisFrame = 0;
+}
+
+
+bool UShooterEffectsSubsystem::HasPendingWork() const
+{
+	return GetWorld()->GetNetMode() != NM_DedicatedServer;
+}
+
+
+void UShooterEffectsSubsystem::Deinitialize()
+{
+	ImpactTables.Reset();
+	ParticlePool.Reset();
+	TrailPool.Reset();
+
+	Super::Deinitialize();
+}
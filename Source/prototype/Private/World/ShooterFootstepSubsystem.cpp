@@ -0,0 +1,164 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "World/ShooterFootstepSubsystem.h"
+#include "World/ShooterDecalSubsystem.h"
+#include "ShooterBaseCharacter.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
+#include "Engine/DecalActor.h"
+#include "Components/DecalComponent.h"
+#include "Engine/World.h"
+
+
+static int32 MaxFootstepTracesPerFrame = 16;
+FAutoConsoleVariableRef CVARMaxFootstepTracesPerFrame(
+	TEXT("COOP.MaxFootstepTracesPerFrame"),
+	MaxFootstepTracesPerFrame,
+	TEXT("Footsteps beyond this number within one frame leave no footprint"),
+	ECVF_Cheat);
+
+
+namespace ShooterFootsteps
+{
+	/* Trace from above to below the foot */
+	const float TraceHalfHeight = 20.0f;
+}
+
+
+void UShooterFootstepSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	NextFootstepId = 0;
+	TraceDelegate.BindUObject(this, &UShooterFootstepSubsystem::OnFootTraceComplete);
+}
+
+
+void UShooterFootstepSubsystem::QueueFootstep(AShooterBaseCharacter* Character, const FVector& FootLocation, const FVector& FootForward, TSubclassOf<AActor> FootprintDecal, float FallbackLifeSpan)
+{
+	if (Character == nullptr || FootprintDecal == nullptr)
+	{
+		return;
+	}
+
+	/* The movement component knows the floor without a trace, the surface only has to be looked up again when that changes */
+	const UCharacterMovementComponent* Movement = Character->GetCharacterMovement();
+	const UPrimitiveComponent* Floor = Movement ? Movement->CurrentFloor.HitResult.GetComponent() : nullptr;
+
+	FPendingFootstep& Footstep = QueuedFootsteps.AddDefaulted_GetRef();
+	Footstep.Character = Character;
+	Footstep.Location = FootLocation;
+	Footstep.Forward = FootForward;
+	Footstep.FootprintDecal = FootprintDecal;
+	Footstep.FallbackLifeSpan = FallbackLifeSpan;
+	Footstep.bWantsSurface = Floor == nullptr || !Character->HasFootstepSurface(Floor, FootLocation);
+	Footstep.Id = NextFootstepId++;
+}
+
+
+void UShooterFootstepSubsystem::Tick(float DeltaTime)
+{
+	UWorld* World = GetWorld();
+
+	/* Steps over the budget are dropped, a footprint traced a frame later would already be in the wrong place */
+	const int32 NumTraces = FMath::Min(QueuedFootsteps.Num(), FMath::Max(0, MaxFootstepTracesPerFrame));
+	for (int32 Index = 0; Index < NumTraces; Index++)
+	{
+		const FPendingFootstep& Footstep = QueuedFootsteps[Index];
+
+		FCollisionQueryParams TraceParams(TEXT("FootprintTrace"), true, Footstep.Character.Get());
+		TraceParams.bReturnPhysicalMaterial = Footstep.bWantsSurface;
+
+		const FVector Offset(0.0f, 0.0f, ShooterFootsteps::TraceHalfHeight);
+		World->AsyncLineTraceByChannel(EAsyncTraceType::Single, Footstep.Location + Offset, Footstep.Location - Offset, ECC_Visibility, TraceParams,
+			FCollisionResponseParams::DefaultResponseParam, &TraceDelegate, Footstep.Id);
+
+		TracingFootsteps.Add(Footstep);
+	}
+
+	QueuedFootsteps.Reset();
+}
+
+
+void UShooterFootstepSubsystem::OnFootTraceComplete(const FTraceHandle& Handle, FTraceDatum& Datum)
+{
+	const uint32 Id = Datum.UserData;
+	const int32 Index = TracingFootsteps.IndexOfByPredicate([Id](const FPendingFootstep& Footstep)
+	{
+		return Footstep.Id == Id;
+	});
+
+	if (Index == INDEX_NONE)
+	{
+		return;
+	}
+
+	const FPendingFootstep Footstep = TracingFootsteps[Index];
+	TracingFootsteps.RemoveAtSwap(Index, 1, false);
+
+	if (Datum.OutHits.Num() == 0 || !Datum.OutHits[0].bBlockingHit)
+	{
+		return;
+	}
+
+	const FHitResult& Hit = Datum.OutHits[0];
+
+	AShooterBaseCharacter* Character = Footstep.Character.Get();
+	if (Character && Footstep.bWantsSurface)
+	{
+		Character->SetFootstepSurface(Hit.GetComponent(), Footstep.Location, UPhysicalMaterial::DetermineSurfaceType(Hit.PhysMaterial.Get()));
+	}
+
+	PlaceFootprint(Footstep, Hit);
+}
+
+
+void UShooterFootstepSubsystem::PlaceFootprint(const FPendingFootstep& Footstep, const FHitResult& Hit)
+{
+	// Create a rotator using the landscape normal and our foot forward vectors
+	// Note that we use the function ZX to enforce the normal direction (Z)
+	const FRotator Rotation = FRotationMatrix::MakeFromZX(Hit.Normal, Footstep.Forward).Rotator();
+
+	/* Decal actors are taken apart and placed through the decal budget, the actor class only supplies the settings */
+	const ADecalActor* DecalDefaults = Cast<ADecalActor>(Footstep.FootprintDecal->GetDefaultObject());
+	UShooterDecalSubsystem* DecalSubsystem = UShooterTickableWorldSubsystem::Get<UShooterDecalSubsystem>(this);
+	if (DecalDefaults && DecalDefaults->GetDecal() && DecalSubsystem)
+	{
+		const UDecalComponent* DecalTemplate = DecalDefaults->GetDecal();
+		const FTransform DecalTransform = DecalTemplate->GetRelativeTransform() * FTransform(Rotation, Hit.Location);
+
+		float LifeSpan = DecalDefaults->InitialLifeSpan;
+		if (LifeSpan <= 0.0f)
+		{
+			LifeSpan = DecalTemplate->FadeStartDelay + DecalTemplate->FadeDuration;
+		}
+		if (LifeSpan <= 0.0f)
+		{
+			LifeSpan = Footstep.FallbackLifeSpan;
+		}
+
+		DecalSubsystem->SpawnDecal(EShooterDecalCategory::Footprint, DecalTemplate->GetDecalMaterial(), DecalTemplate->DecalSize,
+			DecalTransform.GetLocation(), DecalTransform.Rotator(), LifeSpan);
+		return;
+	}
+
+	// Spawn decal and particle emitter
+	GetWorld()->SpawnActor(Footstep.FootprintDecal, &Hit.Location, &Rotation);
+}
+
+
+bool UShooterFootstepSubsystem::HasPendingWork() const
+{
+	return QueuedFootsteps.Num() > 0;
+}
+
+
+void UShooterFootstepSubsystem::Deinitialize()
+{
+	QueuedFootsteps.Reset();
+	TracingFootsteps.Reset();
+	TraceDelegate.Unbind();
+
+	Super::Deinitialize();
+}
@@ -20,6 +20,9 @@
 #include "EngineUtils.h"
 #include "Components/CapsuleComponent.h"
 #include "Engine/LevelScriptActor.h"
+#include "World/ShooterAIBenchmark.h"
+#include "World/ShooterWeaponPoolSubsystem.h"
+#include "Misc/CommandLine.h"
 #include "../prototype.h"
 
 
@@ -76,6 +79,11 @@ void AShooterGameMode::StartMatch()
 	{
 		/* Spawn a new bot every 5 seconds (bothandler will opt-out based on his own rules for example to only spawn during night time) */
 		GetWorldTimerManager().SetTimer(TimerHandle_BotSpawns, this, &AShooterGameMode::SpawnBotHandler, BotSpawnInterval, true);
+
+		if (FParse::Param(FCommandLine::Get(), TEXT("AIBenchmark")))
+		{
+			StartAIBenchmark();
+		}
 	}
 
 	Super::StartMatch();
@@ -305,6 +313,26 @@ void AShooterGameMode::SpawnNewBot()
 	GetWorld()->SpawnActor<APawn>(BotPawnClass, SpawnTransform);
 }
 
+
+void AShooterGameMode::StartAIBenchmark()
+{
+	if (AIBenchmarkClass == nullptr)
+	{
+		UE_LOG(LogGame, Warning, TEXT("No AIBenchmarkClass assigned, cannot start AI benchmark."));
+		return;
+	}
+
+	/* Regular night spawns would skew the measured populations */
+	bSpawnZombiesAtNight = false;
+	GetWorldTimerManager().ClearTimer(TimerHandle_BotSpawns);
+
+	AShooterAIBenchmark* Benchmark = GetWorld()->SpawnActor<AShooterAIBenchmark>(AIBenchmarkClass, FTransform::Identity);
+	if (Benchmark)
+	{
+		Benchmark->StartBenchmark();
+	}
+}
+
 /* Used by RestartPlayer() to determine the pawn to create and possess when a bot or player spawns */
 UClass* AShooterGameMode::GetDefaultPawnClassForController_Implementation(AController* InController)
 {
@@ -403,15 +431,15 @@ void AShooterGameMode::SetPlayerDefaults(APawn* PlayerPawn)
 void AShooterGameMode::SpawnDefaultInventory(APawn* PlayerPawn)
 {
 	AShooterCharacter* MyPawn = Cast<AShooterCharacter>(PlayerPawn);
-	if (MyPawn)
+	UShooterWeaponPoolSubsystem* WeaponPool = UShooterWeaponPoolSubsystem::Get(this);
+	if (MyPawn && WeaponPool)
 	{
 		for (int32 i = 0; i < DefaultInventoryClasses.Num(); i++)
 		{
 			if (DefaultInventoryClasses[i])
 			{
-				FActorSpawnParameters SpawnInfo;
-				SpawnInfo.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
-				AShooterWeapon* NewWeapon = GetWorld()->SpawnActor<AShooterWeapon>(DefaultInventoryClasses[i], SpawnInfo);
+				/* Weapons of the players that died before are reused */
+				AShooterWeapon* NewWeapon = WeaponPool->AcquireWeapon(DefaultInventoryClasses[i]);
 
 				MyPawn->AddWeapon(NewWeapon);
 			}
@@ -0,0 +1,379 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "World/ShooterLagCompensationSubsystem.h"
+#include "ShooterBaseCharacter.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+#include "PhysicsEngine/SkeletalBodySetup.h"
+#include "GameFramework/GameStateBase.h"
+#include "DrawDebugHelpers.h"
+
+
+static float LagCompensationMaxRewind = 0.4f;
+FAutoConsoleVariableRef CVARLagCompensationMaxRewind(
+	TEXT("COOP.LagCompensationMaxRewind"),
+	LagCompensationMaxRewind,
+	TEXT("Maximum seconds a client shot may be rewound, older time stamps are clamped"),
+	ECVF_Cheat);
+
+static int32 DebugLagCompensationDrawing = 0;
+FAutoConsoleVariableRef CVARDebugLagCompensationDrawing(
+	TEXT("COOP.DebugLagCompensation"),
+	DebugLagCompensationDrawing,
+	TEXT("Draw the rewound hitboxes of validated shots (green = confirmed, red = rejected)"),
+	ECVF_Cheat);
+
+
+namespace ShooterLagCompensation
+{
+	/* Ring buffer length, covers MaxRewind at server tick rates down to 60 Hz */
+	const int32 HistoryFrames = 32;
+}
+
+
+float UShooterLagCompensationSubsystem::GetShotTimestamp(const UObject* WorldContextObject)
+{
+	UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	if (World == nullptr)
+	{
+		return 0.0f;
+	}
+
+	/* Clients see remote pawns roughly half a round trip in the past, which is about what their server time estimate lags behind */
+	AGameStateBase* GameState = World->GetGameState();
+	return GameState ? GameState->GetServerWorldTimeSeconds() : World->GetTimeSeconds();
+}
+
+
+void UShooterLagCompensationSubsystem::Register(AShooterBaseCharacter* Character)
+{
+	if (Character == nullptr || HistoryLookup.Contains(Character))
+	{
+		return;
+	}
+
+	FCharacterHistory& History = Histories.AddDefaulted_GetRef();
+	History.Character = Character;
+	History.Head = INDEX_NONE;
+	History.NumFrames = 0;
+
+	BuildShapes(Character, History.Shapes);
+
+	History.Timestamps.SetNumZeroed(ShooterLagCompensation::HistoryFrames);
+	History.Bounds.SetNumZeroed(ShooterLagCompensation::HistoryFrames);
+	History.Samples.SetNumZeroed(ShooterLagCompensation::HistoryFrames * History.Shapes.Num());
+
+	HistoryLookup.Add(Character, Histories.Num() - 1);
+
+	/* Servers don't render, make sure bone transforms are refreshed so the recorded hitboxes follow the animation */
+	USkeletalMeshComponent* Mesh = Character->GetMesh();
+	if (Mesh && Character->GetNetMode() == NM_DedicatedServer)
+	{
+		Mesh->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones;
+	}
+}
+
+
+void UShooterLagCompensationSubsystem::Unregister(AShooterBaseCharacter* Character)
+{
+	int32 Index = INDEX_NONE;
+	if (!HistoryLookup.RemoveAndCopyValue(Character, Index))
+	{
+		return;
+	}
+
+	/* Keep the array dense, patch the lookup of the history moved into the gap */
+	Histories.RemoveAtSwap(Index, 1, false);
+	if (Histories.IsValidIndex(Index))
+	{
+		HistoryLookup.Add(Histories[Index].Character.Get(), Index);
+	}
+}
+
+
+bool UShooterLagCompensationSubsystem::IsTracked(const AActor* Actor) const
+{
+	return Actor && HistoryLookup.Contains(Actor);
+}
+
+
+void UShooterLagCompensationSubsystem::BuildShapes(AShooterBaseCharacter* Character, TArray<FHitboxShape>& OutShapes) const
+{
+	OutShapes.Reset();
+
+	USkeletalMeshComponent* Mesh = Character->GetMesh();
+	UPhysicsAsset* PhysicsAsset = Mesh ? Mesh->GetPhysicsAsset() : nullptr;
+	if (PhysicsAsset)
+	{
+		for (USkeletalBodySetup* BodySetup : PhysicsAsset->SkeletalBodySetups)
+		{
+			const int32 BoneIndex = BodySetup ? Mesh->GetBoneIndex(BodySetup->BoneName) : INDEX_NONE;
+			if (BoneIndex == INDEX_NONE)
+			{
+				continue;
+			}
+
+			FHitboxShape Shape;
+			Shape.BoneIndex = BoneIndex;
+			Shape.BoneName = BodySetup->BoneName;
+			Shape.PhysMaterial = BodySetup->PhysMaterial;
+
+			/* Weapon traces hit the bodies of the physics asset, one capsule per body is accurate enough */
+			if (BodySetup->AggGeom.SphylElems.Num() > 0)
+			{
+				const FKSphylElem& Sphyl = BodySetup->AggGeom.SphylElems[0];
+				Shape.LocalTransform = Sphyl.GetTransform();
+				Shape.Radius = Sphyl.Radius;
+				Shape.HalfLength = Sphyl.Length * 0.5f;
+			}
+			else if (BodySetup->AggGeom.SphereElems.Num() > 0)
+			{
+				const FKSphereElem& Sphere = BodySetup->AggGeom.SphereElems[0];
+				Shape.LocalTransform = Sphere.GetTransform();
+				Shape.Radius = Sphere.Radius;
+				Shape.HalfLength = 0.0f;
+			}
+			else if (BodySetup->AggGeom.BoxElems.Num() > 0)
+			{
+				const FKBoxElem& Box = BodySetup->AggGeom.BoxElems[0];
+				Shape.LocalTransform = Box.GetTransform();
+				Shape.Radius = FMath::Min(Box.X, Box.Y) * 0.5f;
+				Shape.HalfLength = FMath::Max(0.0f, Box.Z * 0.5f - Shape.Radius);
+			}
+			else
+			{
+				continue;
+			}
+
+			OutShapes.Add(Shape);
+		}
+	}
+
+	/* No physics asset, fall back to the collision capsule */
+	if (OutShapes.Num() == 0)
+	{
+		UCapsuleComponent* Capsule = Character->GetCapsuleComponent();
+
+		FHitboxShape Shape;
+		Shape.BoneIndex = INDEX_NONE;
+		Shape.BoneName = NAME_None;
+		Shape.LocalTransform = FTransform::Identity;
+		Shape.Radius = Capsule->GetUnscaledCapsuleRadius();
+		Shape.HalfLength = Capsule->GetUnscaledCapsuleHalfHeight_WithoutHemisphere();
+		OutShapes.Add(Shape);
+	}
+}
+
+
+void UShooterLagCompensationSubsystem::RecordFrame(FCharacterHistory& History, float Timestamp)
+{
+	AShooterBaseCharacter* Character = History.Character.Get();
+	USkeletalMeshComponent* Mesh = Character->GetMesh();
+
+	History.Head = (History.Head + 1) % ShooterLagCompensation::HistoryFrames;
+	History.NumFrames = FMath::Min(History.NumFrames + 1, ShooterLagCompensation::HistoryFrames);
+	History.Timestamps[History.Head] = Timestamp;
+
+	const int32 NumShapes = History.Shapes.Num();
+	FHitboxSample* FrameSamples = &History.Samples[History.Head * NumShapes];
+
+	FVector BoundsMin(MAX_flt);
+	FVector BoundsMax(-MAX_flt);
+
+	for (int32 i = 0; i < NumShapes; i++)
+	{
+		const FHitboxShape& Shape = History.Shapes[i];
+
+		const FTransform ParentTransform = Shape.BoneIndex != INDEX_NONE ? Mesh->GetBoneTransform(Shape.BoneIndex) : Character->GetCapsuleComponent()->GetComponentTransform();
+		const FTransform WorldTransform = Shape.LocalTransform * ParentTransform;
+
+		FHitboxSample& Sample = FrameSamples[i];
+		Sample.Center = WorldTransform.GetLocation();
+		Sample.HalfAxis = WorldTransform.GetRotation().GetAxisZ() * Shape.HalfLength;
+
+		const FVector Extent(Sample.HalfAxis.GetAbs() + FVector(Shape.Radius));
+		BoundsMin = BoundsMin.ComponentMin(Sample.Center - Extent);
+		BoundsMax = BoundsMax.ComponentMax(Sample.Center + Extent);
+	}
+
+	const FVector BoundsCenter = (BoundsMin + BoundsMax) * 0.5f;
+	History.Bounds[History.Head] = FVector4(BoundsCenter, (BoundsMax - BoundsCenter).Size());
+}
+
+
+FVector4 UShooterLagCompensationSubsystem::GetRewoundHitboxes(const FCharacterHistory& History, float Timestamp, FHitboxSampleArray& OutSamples) const
+{
+	const int32 NumShapes = History.Shapes.Num();
+
+	/* Walk back from the newest frame until we find the one just before the requested time */
+	int32 Newer = History.Head;
+	int32 Older = History.Head;
+	for (int32 i = 1; i < History.NumFrames; i++)
+	{
+		if (History.Timestamps[Older] <= Timestamp)
+		{
+			break;
+		}
+
+		Newer = Older;
+		Older = (Older - 1 + ShooterLagCompensation::HistoryFrames) % ShooterLagCompensation::HistoryFrames;
+	}
+
+	const float OlderTime = History.Timestamps[Older];
+	const float NewerTime = History.Timestamps[Newer];
+	const float Alpha = NewerTime > OlderTime ? FMath::Clamp((Timestamp - OlderTime) / (NewerTime - OlderTime), 0.0f, 1.0f) : 1.0f;
+
+	const FHitboxSample* OlderSamples = &History.Samples[Older * NumShapes];
+	const FHitboxSample* NewerSamples = &History.Samples[Newer * NumShapes];
+
+	OutSamples.SetNumUninitialized(NumShapes);
+	for (int32 i = 0; i < NumShapes; i++)
+	{
+		OutSamples[i].Center = FMath::Lerp(OlderSamples[i].Center, NewerSamples[i].Center, Alpha);
+		OutSamples[i].HalfAxis = FMath::Lerp(OlderSamples[i].HalfAxis, NewerSamples[i].HalfAxis, Alpha);
+	}
+
+	/* Covers both frames so it also covers everything in between */
+	const FVector4& OlderBounds = History.Bounds[Older];
+	const FVector4& NewerBounds = History.Bounds[Newer];
+	const FVector BoundsCenter = FMath::Lerp(FVector(OlderBounds), FVector(NewerBounds), Alpha);
+	const float BoundsRadius = FMath::Max(OlderBounds.W, NewerBounds.W) + FVector::Dist(FVector(OlderBounds), FVector(NewerBounds));
+
+	return FVector4(BoundsCenter, BoundsRadius);
+}
+
+
+bool UShooterLagCompensationSubsystem::RewindTrace(const AShooterBaseCharacter* Character, float Timestamp, const FVector& Start, const FVector& End, FHitResult& OutHit) const
+{
+	const int32* Index = HistoryLookup.Find(Character);
+	if (Index == nullptr || Histories[*Index].NumFrames == 0)
+	{
+		return false;
+	}
+
+	const FCharacterHistory& History = Histories[*Index];
+
+	/* Never rewind further than allowed or into the future */
+	const float Now = History.Timestamps[History.Head];
+	const float RewindTime = FMath::Clamp(Timestamp, Now - LagCompensationMaxRewind, Now);
+
+	FHitboxSampleArray Samples;
+	const FVector4 Bounds = GetRewoundHitboxes(History, RewindTime, Samples);
+
+	/* Spatial prefilter, most rejected shots don't come near the character at all */
+	const bool bNearBounds = FMath::PointDistToSegmentSquared(FVector(Bounds), Start, End) <= FMath::Square(Bounds.W);
+
+	int32 BestShape = INDEX_NONE;
+	float BestDistSq = MAX_flt;
+	FVector BestRayPoint = FVector::ZeroVector;
+	FVector BestAxisPoint = FVector::ZeroVector;
+
+	if (bNearBounds)
+	{
+		for (int32 i = 0; i < Samples.Num(); i++)
+		{
+			const FHitboxSample& Sample = Samples[i];
+
+			FVector RayPoint;
+			FVector AxisPoint;
+			FMath::SegmentDistToSegmentSafe(Start, End, Sample.Center - Sample.HalfAxis, Sample.Center + Sample.HalfAxis, RayPoint, AxisPoint);
+
+			if (FVector::DistSquared(RayPoint, AxisPoint) > FMath::Square(History.Shapes[i].Radius))
+			{
+				continue;
+			}
+
+			/* Closest hitbox along the ray wins */
+			const float DistSq = FVector::DistSquared(Start, RayPoint);
+			if (DistSq < BestDistSq)
+			{
+				BestDistSq = DistSq;
+				BestShape = i;
+				BestRayPoint = RayPoint;
+				BestAxisPoint = AxisPoint;
+			}
+		}
+	}
+
+	if (DebugLagCompensationDrawing)
+	{
+		const FColor DebugColor = BestShape != INDEX_NONE ? FColor::Green : FColor::Red;
+		for (int32 i = 0; i < Samples.Num(); i++)
+		{
+			const FQuat Rotation = FRotationMatrix::MakeFromZ(Samples[i].HalfAxis.IsNearlyZero() ? FVector::UpVector : Samples[i].HalfAxis).ToQuat();
+			DrawDebugCapsule(GetWorld(), Samples[i].Center, Samples[i].HalfAxis.Size() + History.Shapes[i].Radius, History.Shapes[i].Radius, Rotation, DebugColor, false, 2.0f);
+		}
+		DrawDebugLine(GetWorld(), Start, End, DebugColor, false, 2.0f);
+	}
+
+	if (BestShape == INDEX_NONE)
+	{
+		return false;
+	}
+
+	const FHitboxShape& Shape = History.Shapes[BestShape];
+	const FVector Normal = (BestRayPoint - BestAxisPoint).GetSafeNormal(KINDA_SMALL_NUMBER, (Start - End).GetSafeNormal());
+	const FVector ImpactPoint = BestAxisPoint + Normal * Shape.Radius;
+
+	OutHit = FHitResult(ForceInit);
+	OutHit.bBlockingHit = true;
+	OutHit.Actor = const_cast<AShooterBaseCharacter*>(Character);
+	OutHit.Component = Shape.BoneIndex != INDEX_NONE ? (UPrimitiveComponent*)Character->GetMesh() : (UPrimitiveComponent*)Character->GetCapsuleComponent();
+	OutHit.BoneName = Shape.BoneName;
+	OutHit.PhysMaterial = Shape.PhysMaterial;
+	OutHit.TraceStart = Start;
+	OutHit.TraceEnd = End;
+	OutHit.ImpactPoint = ImpactPoint;
+	OutHit.Location = ImpactPoint;
+	OutHit.ImpactNormal = Normal;
+	OutHit.Normal = Normal;
+	OutHit.Distance = FVector::Dist(Start, ImpactPoint);
+	OutHit.Time = OutHit.Distance / FMath::Max(FVector::Dist(Start, End), KINDA_SMALL_NUMBER);
+
+	return true;
+}
+
+
+void UShooterLagCompensationSubsystem::Tick(float DeltaTime)
+{
+	const float Timestamp = GetShotTimestamp(this);
+
+	for (int32 i = Histories.Num() - 1; i >= 0; i--)
+	{
+		if (!Histories[i].Character.IsValid())
+		{
+			/* Destroyed without unregistering, rebuild the lookup below */
+			Histories.RemoveAtSwap(i, 1, false);
+			continue;
+		}
+
+		RecordFrame(Histories[i], Timestamp);
+	}
+
+	if (HistoryLookup.Num() != Histories.Num())
+	{
+		HistoryLookup.Reset();
+		for (int32 i = 0; i < Histories.Num(); i++)
+		{
+			HistoryLookup.Add(Histories[i].Character.Get(), i);
+		}
+	}
+}
+
+
+bool UShooterLagCompensationSubsystem::HasPendingWork() const
+{
+	/* Only the server validates hits */
+	return GetWorld()->GetNetMode() < NM_Client && Histories.Num() > 0;
+}
+
+
+void UShooterLagCompensationSubsystem::Deinitialize()
+{
+	Histories.Reset();
+	HistoryLookup.Reset();
+
+	Super::Deinitialize();
+}
@@ -0,0 +1,656 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "World/ShooterNavQuerySubsystem.h"
+#include "NavigationSystem.h"
+#include "NavigationData.h"
+#include "NavFilters/NavigationQueryFilter.h"
+#include "AI/ShooterAIStats.h"
+#include "Engine/Engine.h"
+#include "../prototype.h"
+
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Nav Queries Pending"), STAT_ShooterNav_Pending, STATGROUP_ShooterAI);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Nav Query Latency (ms)"), STAT_ShooterNav_Latency, STATGROUP_ShooterAI);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Nav Query Cache Hit Rate"), STAT_ShooterNav_HitRate, STATGROUP_ShooterAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Nav Cluster Routes"), STAT_ShooterNav_Routes, STATGROUP_ShooterAI);
+
+
+static float NavQueryBudgetMs = 1.0f;
+FAutoConsoleVariableRef CVARNavQueryBudgetMs(
+	TEXT("COOP.NavQueryBudgetMs"),
+	NavQueryBudgetMs,
+	TEXT("Game thread time in milliseconds spent on queued navigation queries per frame (at least one query always runs)"),
+	ECVF_Cheat);
+
+static int32 NavQueryCacheEnabled = 1;
+FAutoConsoleVariableRef CVARNavQueryCacheEnabled(
+	TEXT("COOP.NavQueryCache"),
+	NavQueryCacheEnabled,
+	TEXT("Answer navigation queries from the result cache when possible"),
+	ECVF_Cheat);
+
+static int32 NavHierarchicalEnabled = 1;
+FAutoConsoleVariableRef CVARNavHierarchicalEnabled(
+	TEXT("COOP.NavHierarchical"),
+	NavHierarchicalEnabled,
+	TEXT("Resolve long paths through cached routes between navmesh clusters"),
+	ECVF_Cheat);
+
+static float NavHierarchicalMinDistance = 4000.0f;
+FAutoConsoleVariableRef CVARNavHierarchicalMinDistance(
+	TEXT("COOP.NavHierarchicalMinDistance"),
+	NavHierarchicalMinDistance,
+	TEXT("Straight line distance above which paths are resolved through the cluster routes"),
+	ECVF_Cheat);
+
+static int32 DebugNavQueryStats = 0;
+FAutoConsoleVariableRef CVARDebugNavQueryStats(
+	TEXT("COOP.NavQueryStats"),
+	DebugNavQueryStats,
+	TEXT("Print navigation queue length, latency and cache hit rate every second"),
+	ECVF_Cheat);
+
+
+namespace ShooterNavQuery
+{
+	/* Origins within the same cell share cached results */
+	const float PointCellSize = 100.0f;
+
+	/* Paths are only reused between nearby starts and ends, the first path segment is still valid from anywhere in the cell */
+	const float PathCellSize = 100.0f;
+
+	const float RadiusStep = 50.0f;
+
+	/* Random points cached per key before the cache starts answering */
+	const int32 MaxPointSamples = 8;
+
+	/* Points stay valid until the navmesh changes, paths go stale as soon as the level gets dynamic obstacles */
+	const double PointLifetime = 30.0;
+
+	const double PathLifetime = 2.0;
+
+	const double PruneInterval = 5.0;
+
+	/* Size of the cluster grid used for hierarchical paths, clusters are flat so multi-storey areas get one cluster per floor */
+	const float ClusterSize = 2000.0f;
+
+	const float ClusterHeight = 400.0f;
+
+	FIntVector Quantize(const FVector& Location, float CellSize)
+	{
+		return FIntVector(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize), FMath::FloorToInt(Location.Z / CellSize));
+	}
+}
+
+
+uint32 UShooterNavQuerySubsystem::RequestRandomPointInRadius(const FVector& Origin, float Radius, FShooterNavPointQueryDelegate OnComplete)
+{
+	FQueryRequest Request;
+	Request.Type = EQueryType::RandomPoint;
+	Request.Origin = Origin;
+	Request.End = Origin;
+	Request.Radius = Radius;
+	Request.OnPointComplete = OnComplete;
+
+	return QueueRequest(MoveTemp(Request));
+}
+
+
+uint32 UShooterNavQuerySubsystem::RequestPath(const FVector& Start, const FVector& End, const UObject* Querier, FShooterNavPathQueryDelegate OnComplete)
+{
+	FQueryRequest Request;
+	Request.Type = EQueryType::Path;
+	Request.Origin = Start;
+	Request.End = End;
+	Request.Radius = 0.0f;
+	Request.Querier = Querier;
+	Request.OnPathComplete = OnComplete;
+
+	const INavAgentInterface* NavAgent = Cast<const INavAgentInterface>(Querier);
+	Request.AgentProperties = NavAgent ? NavAgent->GetNavAgentPropertiesRef() : FNavAgentProperties::DefaultProperties;
+
+	return QueueRequest(MoveTemp(Request));
+}
+
+
+uint32 UShooterNavQuerySubsystem::QueueRequest(FQueryRequest&& Request)
+{
+	/* Never hand out 0, callers use it as "no request" */
+	NextRequestId = FMath::Max(NextRequestId + 1, 1u);
+
+	Request.RequestId = NextRequestId;
+	Request.RequestTime = FPlatformTime::Seconds();
+	Request.bCancelled = false;
+	Request.bSuccess = false;
+	Request.Location = Request.Origin;
+
+	NumRequests++;
+
+	if (NavQueryCacheEnabled && ResolveFromCache(Request))
+	{
+		NumCacheHits++;
+		ResolvedRequests.Add(MoveTemp(Request));
+	}
+	else
+	{
+		PendingRequests.Add(MoveTemp(Request));
+	}
+
+	return NextRequestId;
+}
+
+
+void UShooterNavQuerySubsystem::CancelRequest(uint32 RequestId)
+{
+	if (RequestId == 0)
+	{
+		return;
+	}
+
+	/* Only flag the request, the arrays may currently be iterated by Tick */
+	for (FQueryRequest& Request : PendingRequests)
+	{
+		if (Request.RequestId == RequestId)
+		{
+			Request.bCancelled = true;
+			return;
+		}
+	}
+
+	for (FQueryRequest& Request : ResolvedRequests)
+	{
+		if (Request.RequestId == RequestId)
+		{
+			Request.bCancelled = true;
+			return;
+		}
+	}
+}
+
+
+void UShooterNavQuerySubsystem::FlushCache()
+{
+	Cache.Reset();
+	ClusterNodes.Reset();
+	ClusterRoutes.Reset();
+}
+
+
+UShooterNavQuerySubsystem::FCacheKey UShooterNavQuerySubsystem::MakeCacheKey(const FQueryRequest& Request) const
+{
+	FCacheKey Key;
+	Key.Type = Request.Type;
+
+	if (Request.Type == EQueryType::RandomPoint)
+	{
+		Key.Origin = ShooterNavQuery::Quantize(Request.Origin, ShooterNavQuery::PointCellSize);
+		Key.End = FIntVector::ZeroValue;
+		Key.Radius = FMath::RoundToInt(Request.Radius / ShooterNavQuery::RadiusStep);
+	}
+	else
+	{
+		Key.Origin = ShooterNavQuery::Quantize(Request.Origin, ShooterNavQuery::PathCellSize);
+		Key.End = ShooterNavQuery::Quantize(Request.End, ShooterNavQuery::PathCellSize);
+		/* Different agent sizes use different navmeshes */
+		Key.Radius = FMath::RoundToInt(Request.AgentProperties.AgentRadius);
+	}
+
+	return Key;
+}
+
+
+bool UShooterNavQuerySubsystem::ResolveFromCache(FQueryRequest& Request)
+{
+	const FCacheEntry* Entry = Cache.Find(MakeCacheKey(Request));
+	if (Entry == nullptr || Entry->ExpireTime < FPlatformTime::Seconds())
+	{
+		return false;
+	}
+
+	if (!Entry->bSuccess)
+	{
+		/* Remember failures as well, unreachable goals are the most expensive queries */
+		Request.bSuccess = false;
+		return true;
+	}
+
+	if (Request.Type == EQueryType::RandomPoint)
+	{
+		/* Keep sampling until the entry has enough variety */
+		if (Entry->Points.Num() < ShooterNavQuery::MaxPointSamples)
+		{
+			return false;
+		}
+
+		Request.Location = Entry->Points[FMath::RandHelper(Entry->Points.Num())];
+	}
+	else
+	{
+		Request.PathPoints = Entry->Points;
+		Request.Location = Entry->Points.Last();
+	}
+
+	Request.bSuccess = true;
+	return true;
+}
+
+
+void UShooterNavQuerySubsystem::StoreInCache(const FQueryRequest& Request)
+{
+	const double Now = FPlatformTime::Seconds();
+	const FCacheKey Key = MakeCacheKey(Request);
+
+	FCacheEntry* Entry = Cache.Find(Key);
+	if (Entry && Entry->ExpireTime < Now)
+	{
+		Cache.Remove(Key);
+		Entry = nullptr;
+	}
+
+	if (Request.Type == EQueryType::RandomPoint)
+	{
+		/* A failed sample says little about the cell, the next query samples again */
+		if (!Request.bSuccess)
+		{
+			return;
+		}
+
+		if (Entry == nullptr)
+		{
+			Entry = &Cache.Add(Key);
+			Entry->ExpireTime = Now + ShooterNavQuery::PointLifetime;
+		}
+
+		Entry->Points.Add(Request.Location);
+		Entry->bSuccess = true;
+	}
+	else
+	{
+		FCacheEntry& NewEntry = Cache.Add(Key);
+		NewEntry.Points = Request.PathPoints;
+		NewEntry.bSuccess = Request.bSuccess;
+		NewEntry.ExpireTime = Now + ShooterNavQuery::PathLifetime;
+	}
+}
+
+
+void UShooterNavQuerySubsystem::RunQuery(FQueryRequest& Request)
+{
+	SHOOTER_AI_SCOPE(Navigation);
+
+	UNavigationSystemV1* NavSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	if (NavSystem == nullptr)
+	{
+		Request.bSuccess = false;
+		return;
+	}
+
+	if (Request.Type == EQueryType::RandomPoint)
+	{
+		FNavLocation ResultLocation;
+		Request.bSuccess = NavSystem->GetRandomPointInNavigableRadius(Request.Origin, Request.Radius, ResultLocation);
+		Request.Location = ResultLocation.Location;
+	}
+	else
+	{
+		const bool bLongRoute = FVector::DistSquared(Request.Origin, Request.End) > FMath::Square(NavHierarchicalMinDistance);
+
+		Request.bSuccess = (NavHierarchicalEnabled && bLongRoute && FindHierarchicalPath(Request, Request.PathPoints))
+			|| FindPathDirect(Request, Request.Origin, Request.End, Request.PathPoints);
+
+		Request.Location = Request.bSuccess ? Request.PathPoints.Last() : Request.End;
+	}
+
+	if (NavQueryCacheEnabled)
+	{
+		StoreInCache(Request);
+	}
+}
+
+
+bool UShooterNavQuerySubsystem::FindPathDirect(const FQueryRequest& Request, const FVector& Start, const FVector& End, TArray<FVector>& OutPathPoints)
+{
+	OutPathPoints.Reset();
+
+	UNavigationSystemV1* NavSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	const ANavigationData* NavData = NavSystem ? NavSystem->GetNavDataForProps(Request.AgentProperties) : nullptr;
+	if (NavData == nullptr)
+	{
+		return false;
+	}
+
+	NumPathSearches++;
+
+	const UObject* Querier = Request.Querier.Get();
+	FPathFindingQuery Query(Querier, *NavData, Start, End, UNavigationQueryFilter::GetQueryFilter(*NavData, Querier, nullptr));
+
+	const FPathFindingResult Result = NavSystem->FindPathSync(Request.AgentProperties, Query);
+	if (!Result.IsSuccessful() || !Result.Path.IsValid())
+	{
+		return false;
+	}
+
+	const TArray<FNavPathPoint>& NavPoints = Result.Path->GetPathPoints();
+
+	OutPathPoints.Reserve(NavPoints.Num());
+	for (const FNavPathPoint& NavPoint : NavPoints)
+	{
+		OutPathPoints.Add(NavPoint.Location);
+	}
+
+	return OutPathPoints.Num() > 0;
+}
+
+
+bool UShooterNavQuerySubsystem::FindHierarchicalPath(const FQueryRequest& Request, TArray<FVector>& OutPathPoints)
+{
+	FClusterRouteKey RouteKey;
+	RouteKey.From = GetCluster(Request.Origin);
+	RouteKey.To = GetCluster(Request.End);
+	RouteKey.AgentRadius = FMath::RoundToInt(Request.AgentProperties.AgentRadius);
+
+	if (RouteKey.From == RouteKey.To)
+	{
+		return false;
+	}
+
+	const TArray<FVector>* Route = ClusterRoutes.Find(RouteKey);
+	if (Route == nullptr)
+	{
+		/* Routes run between the first navigable points seen in each cluster, so any later query between the same clusters reuses them */
+		FVector FromNode;
+		FVector ToNode;
+
+		TArray<FVector> NewRoute;
+		if (GetClusterNode(RouteKey.From, Request.Origin, FromNode) && GetClusterNode(RouteKey.To, Request.End, ToNode))
+		{
+			FindPathDirect(Request, FromNode, ToNode, NewRoute);
+		}
+
+		/* Unreachable routes are stored as empty so they are not searched again until the navmesh changes */
+		Route = &ClusterRoutes.Add(RouteKey, MoveTemp(NewRoute));
+	}
+	else
+	{
+		NumRouteCacheHits++;
+	}
+
+	if (Route->Num() == 0)
+	{
+		return false;
+	}
+
+	/* Join the route where it passes closest to the start and leave it where it passes closest to the goal */
+	int32 EntryIndex = 0;
+	float BestEntryDistSq = MAX_flt;
+	for (int32 i = 0; i < Route->Num(); i++)
+	{
+		const float DistSq = FVector::DistSquared((*Route)[i], Request.Origin);
+		if (DistSq < BestEntryDistSq)
+		{
+			BestEntryDistSq = DistSq;
+			EntryIndex = i;
+		}
+	}
+
+	int32 ExitIndex = EntryIndex;
+	float BestExitDistSq = MAX_flt;
+	for (int32 i = EntryIndex; i < Route->Num(); i++)
+	{
+		const float DistSq = FVector::DistSquared((*Route)[i], Request.End);
+		if (DistSq < BestExitDistSq)
+		{
+			BestExitDistSq = DistSq;
+			ExitIndex = i;
+		}
+	}
+
+	/* Local refinement, both searches stay short regardless of the total route length */
+	TArray<FVector> ExitPath;
+	if (!FindPathDirect(Request, Request.Origin, (*Route)[EntryIndex], OutPathPoints) || !FindPathDirect(Request, (*Route)[ExitIndex], Request.End, ExitPath))
+	{
+		OutPathPoints.Reset();
+		return false;
+	}
+
+	/* OutPathPoints ends on the entry point and ExitPath starts on the exit point */
+	for (int32 i = EntryIndex + 1; i <= ExitIndex; i++)
+	{
+		OutPathPoints.Add((*Route)[i]);
+	}
+
+	for (int32 i = 1; i < ExitPath.Num(); i++)
+	{
+		OutPathPoints.Add(ExitPath[i]);
+	}
+
+	NumHierarchicalPaths++;
+	return true;
+}
+
+
+FIntVector UShooterNavQuerySubsystem::GetCluster(const FVector& Location) const
+{
+	return FIntVector(
+		FMath::FloorToInt(Location.X / ShooterNavQuery::ClusterSize),
+		FMath::FloorToInt(Location.Y / ShooterNavQuery::ClusterSize),
+		FMath::FloorToInt(Location.Z / ShooterNavQuery::ClusterHeight));
+}
+
+
+bool UShooterNavQuerySubsystem::GetClusterNode(const FIntVector& Cluster, const FVector& Hint, FVector& OutNode)
+{
+	if (const FVector* Node = ClusterNodes.Find(Cluster))
+	{
+		OutNode = *Node;
+		return true;
+	}
+
+	UNavigationSystemV1* NavSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+
+	FNavLocation NavLocation;
+	if (NavSystem == nullptr || !NavSystem->ProjectPointToNavigation(Hint, NavLocation))
+	{
+		return false;
+	}
+
+	OutNode = ClusterNodes.Add(Cluster, NavLocation.Location);
+	return true;
+}
+
+
+void UShooterNavQuerySubsystem::CompleteRequest(FQueryRequest& Request)
+{
+	const double Latency = FPlatformTime::Seconds() - Request.RequestTime;
+	TotalLatencySeconds += Latency;
+	MaxLatencySeconds = FMath::Max(MaxLatencySeconds, Latency);
+	NumCompleted++;
+
+	if (Request.Type == EQueryType::RandomPoint)
+	{
+		Request.OnPointComplete.ExecuteIfBound(Request.bSuccess, Request.Location);
+	}
+	else
+	{
+		Request.OnPathComplete.ExecuteIfBound(Request.bSuccess, Request.PathPoints);
+	}
+}
+
+
+void UShooterNavQuerySubsystem::Tick(float DeltaTime)
+{
+	if (!bBoundToNavigation)
+	{
+		/* The navigation system is created after world subsystems */
+		UNavigationSystemV1* NavSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+		if (NavSystem)
+		{
+			NavSystem->OnNavigationGenerationFinishedDelegate.AddUObject(this, &UShooterNavQuerySubsystem::OnNavigationGenerationFinished);
+			bBoundToNavigation = true;
+		}
+	}
+
+	/* Callbacks may queue or cancel requests, so only work on what was resolved before this tick and flag rather than remove */
+	const int32 NumResolved = ResolvedRequests.Num();
+	for (int32 i = 0; i < NumResolved; i++)
+	{
+		if (!ResolvedRequests[i].bCancelled)
+		{
+			FQueryRequest Request = MoveTemp(ResolvedRequests[i]);
+			CompleteRequest(Request);
+		}
+	}
+
+	if (NumResolved > 0)
+	{
+		ResolvedRequests.RemoveAt(0, NumResolved, false);
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+	const double Budget = NavQueryBudgetMs / 1000.0;
+
+	int32 NumProcessed = 0;
+	while (NumProcessed < PendingRequests.Num())
+	{
+		/* Always make progress, even when a single query exceeds the budget */
+		if (NumProcessed > 0 && FPlatformTime::Seconds() - StartTime >= Budget)
+		{
+			break;
+		}
+
+		/* Copy out, the callback may add to PendingRequests */
+		FQueryRequest Request = MoveTemp(PendingRequests[NumProcessed]);
+		NumProcessed++;
+
+		if (Request.bCancelled)
+		{
+			continue;
+		}
+
+		/* An earlier request in this batch may have filled the cache for this one */
+		if (NavQueryCacheEnabled && ResolveFromCache(Request))
+		{
+			NumCacheHits++;
+		}
+		else
+		{
+			RunQuery(Request);
+		}
+
+		CompleteRequest(Request);
+	}
+
+	if (NumProcessed > 0)
+	{
+		PendingRequests.RemoveAt(0, NumProcessed, false);
+	}
+
+	if (FPlatformTime::Seconds() - LastPruneTime > ShooterNavQuery::PruneInterval)
+	{
+		PruneCache();
+	}
+
+	UpdateStats(DeltaTime);
+}
+
+
+void UShooterNavQuerySubsystem::PruneCache()
+{
+	LastPruneTime = FPlatformTime::Seconds();
+
+	for (auto It = Cache.CreateIterator(); It; ++It)
+	{
+		if (It.Value().ExpireTime < LastPruneTime)
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+
+void UShooterNavQuerySubsystem::UpdateStats(float DeltaTime)
+{
+	SET_DWORD_STAT(STAT_ShooterNav_Pending, PendingRequests.Num());
+	SET_FLOAT_STAT(STAT_ShooterNav_Latency, GetAverageLatencyMs());
+	SET_FLOAT_STAT(STAT_ShooterNav_HitRate, GetCacheHitRate());
+	SET_DWORD_STAT(STAT_ShooterNav_Routes, ClusterRoutes.Num());
+
+	if (!DebugNavQueryStats)
+	{
+		return;
+	}
+
+	StatsReportTime += DeltaTime;
+	if (StatsReportTime < 1.0f)
+	{
+		return;
+	}
+
+	const FString Message = FString::Printf(TEXT("NavQuery: %d pending, %d requests, hit rate %.0f%%, latency avg %.2f ms max %.2f ms, %d cached, %d A* searches, %d hierarchical paths (%d route hits, %d routes)"),
+		PendingRequests.Num(), NumRequests, GetCacheHitRate() * 100.0f, GetAverageLatencyMs(), MaxLatencySeconds * 1000.0, Cache.Num(),
+		NumPathSearches, NumHierarchicalPaths, NumRouteCacheHits, ClusterRoutes.Num());
+
+	UE_LOG(LogGame, Log, TEXT("%s"), *Message);
+	if (GEngine)
+	{
+		GEngine->AddOnScreenDebugMessage((uint64)GetUniqueID(), 1.0f, FColor::White, Message);
+	}
+
+	/* Report per second rather than since the start of the game */
+	ResetStats();
+}
+
+
+void UShooterNavQuerySubsystem::OnNavigationGenerationFinished(ANavigationData* NavData)
+{
+	FlushCache();
+}
+
+
+int32 UShooterNavQuerySubsystem::GetNumPendingRequests() const
+{
+	return PendingRequests.Num() + ResolvedRequests.Num();
+}
+
+
+float UShooterNavQuerySubsystem::GetCacheHitRate() const
+{
+	return NumRequests > 0 ? (float)NumCacheHits / NumRequests : 0.0f;
+}
+
+
+float UShooterNavQuerySubsystem::GetAverageLatencyMs() const
+{
+	return NumCompleted > 0 ? (float)(TotalLatencySeconds / NumCompleted * 1000.0) : 0.0f;
+}
+
+
+void UShooterNavQuerySubsystem::ResetStats()
+{
+	NumRequests = 0;
+	NumCacheHits = 0;
+	NumCompleted = 0;
+	TotalLatencySeconds = 0.0;
+	MaxLatencySeconds = 0.0;
+	NumPathSearches = 0;
+	NumHierarchicalPaths = 0;
+	NumRouteCacheHits = 0;
+	StatsReportTime = 0.0f;
+}
+
+
+void UShooterNavQuerySubsystem::Deinitialize()
+{
+	UNavigationSystemV1* NavSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	if (NavSystem)
+	{
+		NavSystem->OnNavigationGenerationFinishedDelegate.RemoveAll(this);
+	}
+
+	PendingRequests.Reset();
+	ResolvedRequests.Reset();
+	FlushCache();
+
+	Super::Deinitialize();
+}
@@ -0,0 +1,268 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "World/ShooterProjectileSubsystem.h"
+#include "Items/ShooterGrenadeProjectile.h"
+#include "GameFramework/ProjectileMovementComponent.h"
+#include "Components/SphereComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
+#include "GameFramework/WorldSettings.h"
+#include "Engine/World.h"
+
+
+static int32 SimulateProjectiles = 1;
+FAutoConsoleVariableRef CVARSimulateProjectiles(
+	TEXT("COOP.SimulateProjectiles"),
+	SimulateProjectiles,
+	TEXT("Simulate grenades as records until they need their actor, 0 spawns an actor per shot"),
+	ECVF_Cheat);
+
+
+namespace ShooterProjectiles
+{
+	/* Record layout and class index size */
+	const int32 MaxClasses = 255;
+
+	/* Keeps the projectile from starting the next sweep inside the surface it bounced off */
+	const float SurfaceOffset = 0.1f;
+}
+
+
+bool UShooterProjectileSubsystem::LaunchProjectile(TSubclassOf<AActor> ProjectileClass, const FVector& Location, const FRotator& Rotation, APawn* Instigator)
+{
+	if (!SimulateProjectiles)
+	{
+		return false;
+	}
+
+	const int32 ClassIndex = FindOrAddClassInfo(ProjectileClass);
+	if (ClassIndex == INDEX_NONE)
+	{
+		return false;
+	}
+
+	const FShooterProjectileClassInfo& Info = ClassInfos[ClassIndex];
+
+	FSimulatedProjectile& Projectile = Projectiles.AddDefaulted_GetRef();
+	Projectile.Location = Location;
+	Projectile.Velocity = Rotation.Vector() * Info.InitialSpeed;
+	Projectile.Bounciness = Info.Bounciness;
+	Projectile.Friction = Info.Friction;
+	Projectile.ExpireTime = Info.LifeSpan > 0.0f ? GetWorld()->GetTimeSeconds() + Info.LifeSpan : MAX_flt;
+	Projectile.Instigator = Instigator;
+	Projectile.ClassIndex = (uint8)ClassIndex;
+
+	return true;
+}
+
+
+int32 UShooterProjectileSubsystem::FindOrAddClassInfo(TSubclassOf<AActor> ProjectileClass)
+{
+	for (int32 ClassIndex = 0; ClassIndex < ClassInfos.Num(); ClassIndex++)
+	{
+		if (ClassInfos[ClassIndex].ProjectileClass == ProjectileClass)
+		{
+			return ClassIndex;
+		}
+	}
+
+	/* Only grenades with a mesh to draw them by are simulated, the movement settings come from their components */
+	const AShooterGrenadeProjectile* Defaults = ProjectileClass ? Cast<AShooterGrenadeProjectile>(ProjectileClass->GetDefaultObject()) : nullptr;
+	if (Defaults == nullptr || Defaults->SimulationMesh == nullptr || ClassInfos.Num() >= ShooterProjectiles::MaxClasses)
+	{
+		return INDEX_NONE;
+	}
+
+	const UProjectileMovementComponent* Movement = Defaults->GetProjectileMovement();
+	const USphereComponent* Collision = Defaults->GetCollisionComp();
+
+	FShooterProjectileClassInfo& Info = ClassInfos.AddDefaulted_GetRef();
+	Info.ProjectileClass = ProjectileClass;
+	Info.Radius = Collision->GetScaledSphereRadius();
+	Info.InitialSpeed = Movement->InitialSpeed;
+	Info.MaxSpeed = Movement->MaxSpeed;
+	Info.GravityScale = Movement->ProjectileGravityScale;
+	Info.Bounciness = Movement->Bounciness;
+	Info.Friction = Movement->Friction;
+	Info.StopSpeed = Movement->BounceVelocityStopSimulatingThreshold;
+	Info.LifeSpan = Defaults->InitialLifeSpan;
+	Info.bShouldBounce = Movement->bShouldBounce;
+	Info.CollisionChannel = Collision->GetCollisionObjectType();
+	Info.ResponseParams = FCollisionResponseParams(Collision->GetCollisionResponseToChannels());
+
+	if (GetWorld()->GetNetMode() != NM_DedicatedServer)
+	{
+		Info.Visuals = CreatePooledComponent<UInstancedStaticMeshComponent>([Defaults](UInstancedStaticMeshComponent* Visuals)
+		{
+			Visuals->SetStaticMesh(Defaults->SimulationMesh);
+			Visuals->SetMobility(EComponentMobility::Movable);
+			Visuals->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+			Visuals->SetCanEverAffectNavigation(false);
+		});
+	}
+
+	return ClassInfos.Num() - 1;
+}
+
+
+void UShooterProjectileSubsystem::PromoteProjectile(int32 Index, const FHitResult* StopHit)
+{
+	const FSimulatedProjectile Projectile = Projectiles[Index];
+	Projectiles.RemoveAtSwap(Index, 1, false);
+
+	const FShooterProjectileClassInfo& Info = ClassInfos[Projectile.ClassIndex];
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.Instigator = Projectile.Instigator.Get();
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	AShooterGrenadeProjectile* Grenade = GetWorld()->SpawnActor<AShooterGrenadeProjectile>(Info.ProjectileClass, Projectile.Location, Projectile.Velocity.Rotation(), SpawnParams);
+	if (Grenade == nullptr)
+	{
+		return;
+	}
+
+	/* The movement component has already applied its initial speed, continue with the simulated state instead */
+	UProjectileMovementComponent* Movement = Grenade->GetProjectileMovement();
+	Movement->Bounciness = Projectile.Bounciness;
+	Movement->Friction = Projectile.Friction;
+
+	if (StopHit)
+	{
+		Movement->Velocity = FVector::ZeroVector;
+		Movement->StopSimulating(*StopHit);
+	}
+	else
+	{
+		Movement->Velocity = Projectile.Velocity;
+		Movement->UpdateComponentVelocity();
+	}
+}
+
+
+void UShooterProjectileSubsystem::Tick(float DeltaTime)
+{
+	UWorld* World = GetWorld();
+	const float GravityZ = World->GetGravityZ();
+	const float TimeSeconds = World->GetTimeSeconds();
+	const float KillZ = World->GetWorldSettings() ? World->GetWorldSettings()->KillZ : -HALF_WORLD_MAX;
+
+	FCollisionQueryParams QueryParams(TEXT("SimulatedProjectile"), false);
+	QueryParams.bReturnPhysicalMaterial = true;
+
+	/* Backwards so removed records are swapped with ones already moved this frame */
+	for (int32 Index = Projectiles.Num() - 1; Index >= 0; Index--)
+	{
+		FSimulatedProjectile& Projectile = Projectiles[Index];
+		const FShooterProjectileClassInfo& Info = ClassInfos[Projectile.ClassIndex];
+
+		if (TimeSeconds >= Projectile.ExpireTime || Projectile.Location.Z < KillZ)
+		{
+			Projectiles.RemoveAtSwap(Index, 1, false);
+			continue;
+		}
+
+		Projectile.Velocity.Z += GravityZ * Info.GravityScale * DeltaTime;
+		if (Info.MaxSpeed > 0.0f)
+		{
+			Projectile.Velocity = Projectile.Velocity.GetClampedToMaxSize(Info.MaxSpeed);
+		}
+
+		const FVector End = Projectile.Location + Projectile.Velocity * DeltaTime;
+
+		QueryParams.ClearIgnoredActors();
+		QueryParams.AddIgnoredActor(Projectile.Instigator.Get());
+
+		FHitResult Hit;
+		if (!World->SweepSingleByChannel(Hit, Projectile.Location, End, FQuat::Identity, Info.CollisionChannel, FCollisionShape::MakeSphere(Info.Radius), QueryParams, Info.ResponseParams))
+		{
+			Projectile.Location = End;
+			continue;
+		}
+
+		Projectile.Location = Hit.Location + Hit.Normal * ShooterProjectiles::SurfaceOffset;
+
+		/* Physics objects are pushed around by the actor and its movement component */
+		if (Hit.Component.IsValid() && Hit.Component->IsSimulatingPhysics())
+		{
+			PromoteProjectile(Index, nullptr);
+			continue;
+		}
+
+		UPhysicalMaterial* PhysMat = Hit.PhysMaterial.Get();
+		if (PhysMat)
+		{
+			Projectile.Bounciness = PhysMat->Restitution;
+			Projectile.Friction = PhysMat->Friction;
+		}
+
+		/* Same response as the bounce of the projectile movement component: friction on the tangent, bounciness on the normal */
+		const float VelocityDotNormal = Projectile.Velocity | Hit.Normal;
+		if (VelocityDotNormal < 0.0f)
+		{
+			const FVector NormalVelocity = Hit.Normal * -VelocityDotNormal;
+			Projectile.Velocity = (Projectile.Velocity + NormalVelocity) * FMath::Clamp(1.0f - Projectile.Friction, 0.0f, 1.0f) + NormalVelocity * FMath::Max(Projectile.Bounciness, 0.0f);
+		}
+
+		if (!Info.bShouldBounce || Projectile.Velocity.Size() < Info.StopSpeed)
+		{
+			PromoteProjectile(Index, &Hit);
+		}
+	}
+
+	UpdateVisuals();
+}
+
+
+void UShooterProjectileSubsystem::UpdateVisuals()
+{
+	for (int32 ClassIndex = 0; ClassIndex < ClassInfos.Num(); ClassIndex++)
+	{
+		UInstancedStaticMeshComponent* Visuals = ClassInfos[ClassIndex].Visuals;
+		if (Visuals == nullptr)
+		{
+			continue;
+		}
+
+		InstanceTransforms.Reset();
+		for (const FSimulatedProjectile& Projectile : Projectiles)
+		{
+			if (Projectile.ClassIndex == ClassIndex)
+			{
+				InstanceTransforms.Add(FTransform(Projectile.Velocity.Rotation(), Projectile.Location));
+			}
+		}
+
+		/* Instances don't belong to a projectile, only the count has to match. Removing from the end doesn't shift any */
+		while (Visuals->GetInstanceCount() > InstanceTransforms.Num())
+		{
+			Visuals->RemoveInstance(Visuals->GetInstanceCount() - 1);
+		}
+
+		while (Visuals->GetInstanceCount() < InstanceTransforms.Num())
+		{
+			Visuals->AddInstanceWorldSpace(FTransform::Identity);
+		}
+
+		if (InstanceTransforms.Num() > 0)
+		{
+			Visuals->BatchUpdateInstancesTransforms(0, InstanceTransforms, true, true, true);
+		}
+	}
+}
+
+
+bool UShooterProjectileSubsystem::HasPendingWork() const
+{
+	return Projectiles.Num() > 0;
+}
+
+
+void UShooterProjectileSubsystem::Deinitialize()
+{
+	Projectiles.Reset();
+	ClassInfos.Reset();
+
+	Super::Deinitialize();
+}
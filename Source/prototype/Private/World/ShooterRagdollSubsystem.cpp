@@ -0,0 +1,194 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "World/ShooterRagdollSubsystem.h"
+#include "ShooterBaseCharacter.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Camera/PlayerCameraManager.h"
+#include "GameFramework/PlayerController.h"
+#include "Engine/World.h"
+
+
+static int32 MaxSimulatedRagdolls = 8;
+FAutoConsoleVariableRef CVARMaxSimulatedRagdolls(
+	TEXT("COOP.MaxSimulatedRagdolls"),
+	MaxSimulatedRagdolls,
+	TEXT("Ragdolls simulating at the same time, the oldest one is frozen in its pose when another one starts"),
+	ECVF_Cheat);
+
+static int32 MaxRagdollBodies = 32;
+FAutoConsoleVariableRef CVARMaxRagdollBodies(
+	TEXT("COOP.MaxRagdollBodies"),
+	MaxRagdollBodies,
+	TEXT("Dead bodies kept in the world including frozen ones, the oldest one is removed beyond that"),
+	ECVF_Cheat);
+
+static float RagdollFreezeDistance = 3000.0f;
+FAutoConsoleVariableRef CVARRagdollFreezeDistance(
+	TEXT("COOP.RagdollFreezeDistance"),
+	RagdollFreezeDistance,
+	TEXT("Ragdolls further than this from every local player are frozen after the minimum simulation time"),
+	ECVF_Cheat);
+
+
+namespace ShooterRagdolls
+{
+	/* Bodies are checked a few times per second, settling takes longer than that */
+	const float UpdateInterval = 0.2f;
+
+	/* Every ragdoll gets this long to fall over before settled or distant bodies are frozen */
+	const float MinSimulationTime = 1.0f;
+
+	/* Root body speed below which a body counts as settled */
+	const float SettleSpeed = 15.0f;
+
+	const float SettleTime = 0.6f;
+}
+
+
+bool UShooterRagdollSubsystem::ShouldSimulateRagdoll() const
+{
+	return GetWorld()->GetNetMode() != NM_DedicatedServer;
+}
+
+
+void UShooterRagdollSubsystem::AddRagdoll(AShooterBaseCharacter* Character)
+{
+	if (Character == nullptr)
+	{
+		return;
+	}
+
+	/* Make room for the new body: remove the oldest corpse, freeze the oldest ragdoll still simulating */
+	while (Ragdolls.Num() > 0 && Ragdolls.Num() >= MaxRagdollBodies)
+	{
+		AShooterBaseCharacter* Oldest = Ragdolls[0].Character.Get();
+		if (Oldest)
+		{
+			Oldest->Destroy();
+		}
+		Ragdolls.RemoveAt(0, 1, false);
+	}
+
+	int32 NumSimulating = 0;
+	for (const FRagdoll& Ragdoll : Ragdolls)
+	{
+		NumSimulating += Ragdoll.bFrozen ? 0 : 1;
+	}
+
+	for (int32 Index = 0; Index < Ragdolls.Num() && NumSimulating >= MaxSimulatedRagdolls; Index++)
+	{
+		if (!Ragdolls[Index].bFrozen)
+		{
+			FreezeRagdoll(Ragdolls[Index]);
+			NumSimulating--;
+		}
+	}
+
+	FRagdoll& Ragdoll = Ragdolls.AddDefaulted_GetRef();
+	Ragdoll.Character = Character;
+	Ragdoll.StartTime = GetWorld()->GetTimeSeconds();
+	Ragdoll.SettledTime = 0.0f;
+	Ragdoll.bFrozen = false;
+}
+
+
+void UShooterRagdollSubsystem::FreezeRagdoll(FRagdoll& Ragdoll)
+{
+	Ragdoll.bFrozen = true;
+
+	AShooterBaseCharacter* Character = Ragdoll.Character.Get();
+	USkeletalMeshComponent* Mesh = Character ? Character->GetMesh() : nullptr;
+	if (Mesh == nullptr)
+	{
+		return;
+	}
+
+	/* The bones keep the last simulated pose as long as nothing updates the skeleton again */
+	Mesh->bNoSkeletonUpdate = true;
+	Mesh->SetAllBodiesSimulatePhysics(false);
+	Mesh->SetSimulatePhysics(false);
+	Mesh->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
+	Mesh->SetComponentTickEnabled(false);
+}
+
+
+float UShooterRagdollSubsystem::GetDistanceToViewers(const FVector& Location) const
+{
+	/* No local player (listen server host without a pawn), nobody would notice */
+	float MinDistSquared = MAX_flt;
+	for (const FVector& ViewerLocation : ViewerLocations)
+	{
+		MinDistSquared = FMath::Min(MinDistSquared, FVector::DistSquared(ViewerLocation, Location));
+	}
+
+	return FMath::Sqrt(MinDistSquared);
+}
+
+
+void UShooterRagdollSubsystem::Tick(float DeltaTime)
+{
+	TimeSinceUpdate += DeltaTime;
+	if (TimeSinceUpdate < ShooterRagdolls::UpdateInterval)
+	{
+		return;
+	}
+
+	const float UpdateTime = TimeSinceUpdate;
+	TimeSinceUpdate = 0.0f;
+
+	UWorld* World = GetWorld();
+	const float TimeSeconds = World->GetTimeSeconds();
+
+	ViewerLocations.Reset();
+	for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It)
+	{
+		APlayerController* PC = It->Get();
+		if (PC && PC->IsLocalController() && PC->PlayerCameraManager)
+		{
+			ViewerLocations.Add(PC->PlayerCameraManager->GetCameraLocation());
+		}
+	}
+
+	for (int32 Index = Ragdolls.Num() - 1; Index >= 0; Index--)
+	{
+		FRagdoll& Ragdoll = Ragdolls[Index];
+
+		/* Removed by its life span */
+		AShooterBaseCharacter* Character = Ragdoll.Character.Get();
+		if (Character == nullptr || Character->IsPendingKill())
+		{
+			Ragdolls.RemoveAt(Index, 1, false);
+			continue;
+		}
+
+		if (Ragdoll.bFrozen || TimeSeconds - Ragdoll.StartTime < ShooterRagdolls::MinSimulationTime)
+		{
+			continue;
+		}
+
+		USkeletalMeshComponent* Mesh = Character->GetMesh();
+		const bool bSettling = Mesh->GetPhysicsLinearVelocity().SizeSquared() < FMath::Square(ShooterRagdolls::SettleSpeed);
+		Ragdoll.SettledTime = bSettling ? Ragdoll.SettledTime + UpdateTime : 0.0f;
+
+		if (Ragdoll.SettledTime >= ShooterRagdolls::SettleTime || GetDistanceToViewers(Mesh->GetComponentLocation()) > RagdollFreezeDistance)
+		{
+			FreezeRagdoll(Ragdoll);
+		}
+	}
+}
+
+
+bool UShooterRagdollSubsystem::HasPendingWork() const
+{
+	return Ragdolls.Num() > 0;
+}
+
+
+void UShooterRagdollSubsystem::Deinitialize()
+{
+	Ragdolls.Reset();
+	ViewerLocations.Reset();
+
+	Super::Deinitialize();
+}
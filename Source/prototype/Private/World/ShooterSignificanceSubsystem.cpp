@@ -0,0 +1,352 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "World/ShooterSignificanceSubsystem.h"
+#include "GameFramework/PlayerController.h"
+#include "DrawDebugHelpers.h"
+#include "Engine/World.h"
+
+
+static float SignificanceBudgetScale = 1.0f;
+FAutoConsoleVariableRef CVARSignificanceBudgetScale(
+	TEXT("COOP.SignificanceBudgetScale"),
+	SignificanceBudgetScale,
+	TEXT("Multiplier for the number of High and Medium significance slots per category"),
+	ECVF_Cheat);
+
+static int32 DebugSignificanceDrawing = 0;
+FAutoConsoleVariableRef CVARDebugSignificanceDrawing(
+	TEXT("COOP.DebugSignificance"),
+	DebugSignificanceDrawing,
+	TEXT("Draw the significance tier above registered actors"),
+	ECVF_Cheat);
+
+
+namespace ShooterSignificance
+{
+	struct FBudget
+	{
+		/* Closest actors that may be High / Medium, for effects this is per frame */
+		int32 MaxHigh;
+
+		int32 MaxMedium;
+
+		float HighDistance;
+
+		float MediumDistance;
+
+		/* Beyond this the actor is Culled, no matter how many slots are free */
+		float CullDistance;
+	};
+
+	/* Indexed by EShooterSignificanceCategory */
+	const FBudget Budgets[(int32)EShooterSignificanceCategory::MAX] =
+	{
+		/* Zombie */			{ 8, 24, 1500.0f, 4000.0f, 10000.0f },
+		/* TrackerBot */		{ 4, 12, 1500.0f, 4000.0f, 10000.0f },
+		/* ImpactEffect */		{ 16, 32, 1500.0f, 3000.0f, 6000.0f },
+		/* Footprint */			{ 8, 16, 1000.0f, 2500.0f, 4000.0f },
+		/* WeaponTrail */		{ 12, 24, 1500.0f, 3000.0f, 5000.0f },
+	};
+
+	/* Registered actors are re-ranked at this rate instead of every frame */
+	const float UpdateInterval = 0.25f;
+
+	/* Actors behind all viewers count as this much further away */
+	const float BehindViewerScale = 2.0f;
+
+	const FBudget& GetBudget(EShooterSignificanceCategory Category)
+	{
+		return Budgets[FMath::Clamp((int32)Category, 0, (int32)EShooterSignificanceCategory::MAX - 1)];
+	}
+
+	int32 GetMaxHigh(const FBudget& Budget)
+	{
+		return FMath::CeilToInt(Budget.MaxHigh * SignificanceBudgetScale);
+	}
+
+	int32 GetMaxMedium(const FBudget& Budget)
+	{
+		return FMath::CeilToInt(Budget.MaxMedium * SignificanceBudgetScale);
+	}
+}
+
+
+void UShooterSignificanceSubsystem::Register(AActor* Actor, EShooterSignificanceCategory Category, FShooterSignificanceChanged OnChanged)
+{
+	if (Actor == nullptr)
+	{
+		return;
+	}
+
+	if (Viewers.Num() == 0)
+	{
+		UpdateViewers();
+	}
+
+	FRegistration& Registration = Registrations.Add(Actor);
+	Registration.Category = Category;
+	Registration.OnChanged = OnChanged;
+	Registration.Score = CalculateScore(Actor->GetActorLocation());
+
+	/* Rank is not known until the next update, start with the tier its distance allows */
+	const EShooterSignificance InitialSignificance = GetTierForScore(Category, Registration.Score, 0);
+	Registration.Significance = InitialSignificance;
+
+	OnChanged.ExecuteIfBound(EShooterSignificance::High, InitialSignificance);
+}
+
+
+void UShooterSignificanceSubsystem::Unregister(AActor* Actor)
+{
+	Registrations.Remove(Actor);
+}
+
+
+EShooterSignificance UShooterSignificanceSubsystem::GetSignificance(const AActor* Actor) const
+{
+	const FRegistration* Registration = Registrations.Find(const_cast<AActor*>(Actor));
+	return Registration ? Registration->Significance : EShooterSignificance::High;
+}
+
+
+EShooterSignificance UShooterSignificanceSubsystem::ClaimEffectSignificance(EShooterSignificanceCategory Category, const FVector& Location)
+{
+	return ClaimEffectSlot(Category, CalculateScore(Location));
+}
+
+
+EShooterSignificance UShooterSignificanceSubsystem::ClaimEffectSignificance(EShooterSignificanceCategory Category, const FVector& Start, const FVector& End)
+{
+	return ClaimEffectSlot(Category, CalculateSegmentScore(Start, End));
+}
+
+
+EShooterSignificance UShooterSignificanceSubsystem::ClaimEffectSlot(EShooterSignificanceCategory Category, float Score)
+{
+	const ShooterSignificance::FBudget& Budget = ShooterSignificance::GetBudget(Category);
+	int32* Claims = EffectClaims[(int32)Category];
+
+	EShooterSignificance Significance = GetTierForScore(Category, Score, 0);
+
+	/* Out of slots for this frame, degrade instead of rejecting so distant effects still get their cheap version */
+	if (Significance == EShooterSignificance::High && Claims[(int32)EShooterSignificance::High] >= ShooterSignificance::GetMaxHigh(Budget))
+	{
+		Significance = EShooterSignificance::Medium;
+	}
+
+	if (Significance == EShooterSignificance::Medium && Claims[(int32)EShooterSignificance::Medium] >= ShooterSignificance::GetMaxMedium(Budget))
+	{
+		Significance = EShooterSignificance::Low;
+	}
+
+	Claims[(int32)Significance]++;
+	return Significance;
+}
+
+
+float UShooterSignificanceSubsystem::CalculateScore(const FVector& Location) const
+{
+	float BestScore = MAX_flt;
+
+	for (const FViewer& Viewer : Viewers)
+	{
+		const FVector ToLocation = Location - Viewer.Location;
+		const float Distance = ToLocation.Size();
+
+		const bool bInFront = (ToLocation | Viewer.Direction) >= 0.0f;
+		const float Score = bInFront ? Distance : Distance * ShooterSignificance::BehindViewerScale;
+
+		BestScore = FMath::Min(BestScore, Score);
+	}
+
+	return BestScore;
+}
+
+
+float UShooterSignificanceSubsystem::CalculateSegmentScore(const FVector& Start, const FVector& End) const
+{
+	float BestScore = MAX_flt;
+
+	for (const FViewer& Viewer : Viewers)
+	{
+		const FVector ToLocation = FMath::ClosestPointOnSegment(Viewer.Location, Start, End) - Viewer.Location;
+		const float Distance = ToLocation.Size();
+
+		const bool bInFront = (ToLocation | Viewer.Direction) >= 0.0f;
+		const float Score = bInFront ? Distance : Distance * ShooterSignificance::BehindViewerScale;
+
+		BestScore = FMath::Min(BestScore, Score);
+	}
+
+	return BestScore;
+}
+
+
+EShooterSignificance UShooterSignificanceSubsystem::GetTierForScore(EShooterSignificanceCategory Category, float Score, int32 Rank) const
+{
+	const ShooterSignificance::FBudget& Budget = ShooterSignificance::GetBudget(Category);
+	const int32 MaxHigh = ShooterSignificance::GetMaxHigh(Budget);
+
+	if (Score > Budget.CullDistance)
+	{
+		return EShooterSignificance::Culled;
+	}
+
+	if (Rank < MaxHigh && Score <= Budget.HighDistance)
+	{
+		return EShooterSignificance::High;
+	}
+
+	if (Rank < MaxHigh + ShooterSignificance::GetMaxMedium(Budget) && Score <= Budget.MediumDistance)
+	{
+		return EShooterSignificance::Medium;
+	}
+
+	return EShooterSignificance::Low;
+}
+
+
+void UShooterSignificanceSubsystem::Tick(float DeltaTime)
+{
+	FMemory::Memzero(EffectClaims);
+
+	TimeSinceUpdate += DeltaTime;
+	if (TimeSinceUpdate < ShooterSignificance::UpdateInterval)
+	{
+		return;
+	}
+	TimeSinceUpdate = 0.0f;
+
+	UpdateViewers();
+	UpdateRegistrations();
+
+	if (DebugSignificanceDrawing)
+	{
+		DrawDebug();
+	}
+}
+
+
+void UShooterSignificanceSubsystem::UpdateViewers()
+{
+	Viewers.Reset();
+
+	/* Clients rank for their own view, the server ranks for every connected player (net update rate, AI) */
+	const bool bIsServer = GetWorld()->GetNetMode() < NM_Client;
+
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		APlayerController* PC = It->Get();
+		if (PC == nullptr || (!bIsServer && !PC->IsLocalController()))
+		{
+			continue;
+		}
+
+		FVector ViewLocation;
+		FRotator ViewRotation;
+		PC->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+		FViewer Viewer;
+		Viewer.Location = ViewLocation;
+		Viewer.Direction = ViewRotation.Vector();
+		Viewers.Add(Viewer);
+	}
+}
+
+
+void UShooterSignificanceSubsystem::UpdateRegistrations()
+{
+	struct FRankedActor
+	{
+		AActor* Actor;
+
+		FRegistration* Registration;
+	};
+
+	TArray<FRankedActor> RankedActors[(int32)EShooterSignificanceCategory::MAX];
+
+	for (auto It = Registrations.CreateIterator(); It; ++It)
+	{
+		AActor* Actor = It.Key().Get();
+		if (Actor == nullptr)
+		{
+			It.RemoveCurrent();
+			continue;
+		}
+
+		FRegistration& Registration = It.Value();
+		Registration.Score = CalculateScore(Actor->GetActorLocation());
+
+		RankedActors[(int32)Registration.Category].Add({ Actor, &Registration });
+	}
+
+	/* Collect changes first, callbacks may register or unregister actors */
+	struct FChange
+	{
+		TWeakObjectPtr<AActor> Actor;
+
+		EShooterSignificance OldSignificance;
+
+		EShooterSignificance NewSignificance;
+
+		FShooterSignificanceChanged OnChanged;
+	};
+
+	TArray<FChange> Changes;
+
+	for (int32 CategoryIdx = 0; CategoryIdx < (int32)EShooterSignificanceCategory::MAX; CategoryIdx++)
+	{
+		TArray<FRankedActor>& CategoryActors = RankedActors[CategoryIdx];
+		CategoryActors.Sort([](const FRankedActor& A, const FRankedActor& B)
+		{
+			return A.Registration->Score < B.Registration->Score;
+		});
+
+		for (int32 Rank = 0; Rank < CategoryActors.Num(); Rank++)
+		{
+			FRegistration& Registration = *CategoryActors[Rank].Registration;
+
+			const EShooterSignificance NewSignificance = GetTierForScore(Registration.Category, Registration.Score, Rank);
+			if (NewSignificance != Registration.Significance)
+			{
+				Changes.Add({ CategoryActors[Rank].Actor, Registration.Significance, NewSignificance, Registration.OnChanged });
+				Registration.Significance = NewSignificance;
+			}
+		}
+	}
+
+	for (FChange& Change : Changes)
+	{
+		if (Change.Actor.IsValid())
+		{
+			Change.OnChanged.ExecuteIfBound(Change.OldSignificance, Change.NewSignificance);
+		}
+	}
+}
+
+
+void UShooterSignificanceSubsystem::DrawDebug() const
+{
+	static const FColor TierColors[] = { FColor::Black, FColor::Red, FColor::Yellow, FColor::Green };
+	static const TCHAR* TierNames[] = { TEXT("Culled"), TEXT("Low"), TEXT("Medium"), TEXT("High") };
+
+	for (const auto& Pair : Registrations)
+	{
+		AActor* Actor = Pair.Key.Get();
+		if (Actor)
+		{
+			const int32 Tier = (int32)Pair.Value.Significance;
+			DrawDebugString(GetWorld(), FVector(0, 0, 120.0f), TierNames[Tier], Actor, TierColors[Tier], ShooterSignificance::UpdateInterval, true);
+		}
+	}
+}
+
+
+void UShooterSignificanceSubsystem::Deinitialize()
+{
+	Registrations.Reset();
+	Viewers.Reset();
+
+	Super::Deinitialize();
+}
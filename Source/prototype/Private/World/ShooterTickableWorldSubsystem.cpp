@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "World/ShooterTickableWorldSubsystem.h"
+#include "GameFramework/WorldSettings.h"
+
+
+bool UShooterTickableWorldSubsystem::IsTickable() const
+{
+	/* The class default object is registered as tickable as well but has no world */
+	if (IsTemplate())
+	{
+		return false;
+	}
+
+	const UWorld* World = GetWorld();
+	return World && World->IsGameWorld() && HasPendingWork();
+}
+
+
+TStatId UShooterTickableWorldSubsystem::GetStatId() const
+{
+	/* Named after the subsystem class, so every subsystem shows up on its own */
+#if STATS || ENABLE_STATNAMEDEVENTS_UOBJECT
+	return GetStatID();
+#else
+	return TStatId();
+#endif
+}
+
+
+bool UShooterTickableWorldSubsystem::HasPendingWork() const
+{
+	return true;
+}
+
+
+UObject* UShooterTickableWorldSubsystem::GetPooledComponentOuter() const
+{
+	UWorld* World = GetWorld();
+	return World->GetWorldSettings() ? (UObject*)World->GetWorldSettings() : (UObject*)World;
+}
@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "World/ShooterWeaponPoolSubsystem.h"
+#include "ShooterWeapon.h"
+#include "Engine/World.h"
+
+
+static int32 WeaponPoolSize = 8;
+FAutoConsoleVariableRef CVARWeaponPoolSize(
+	TEXT("COOP.WeaponPoolSize"),
+	WeaponPoolSize,
+	TEXT("Weapons kept for reuse per weapon class, 0 destroys every weapon that leaves an inventory"),
+	ECVF_Cheat);
+
+
+UShooterWeaponPoolSubsystem* UShooterWeaponPoolSubsystem::Get(const UObject* WorldContextObject)
+{
+	UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	return World ? World->GetSubsystem<UShooterWeaponPoolSubsystem>() : nullptr;
+}
+
+
+AShooterWeapon* UShooterWeaponPoolSubsystem::AcquireWeapon(TSubclassOf<AShooterWeapon> WeaponClass)
+{
+	if (WeaponClass == nullptr)
+	{
+		return nullptr;
+	}
+
+	FShooterWeaponPool* Pool = Pools.Find(WeaponClass);
+	while (Pool && Pool->Weapons.Num() > 0)
+	{
+		AShooterWeapon* Weapon = Pool->Weapons.Pop(false);
+
+		/* Pooled weapons can still be destroyed from outside (level streaming, cheats) */
+		if (IsValid(Weapon))
+		{
+			Weapon->OnLeavePool();
+			return Weapon;
+		}
+	}
+
+	FActorSpawnParameters SpawnInfo;
+	SpawnInfo.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	return GetWorld()->SpawnActor<AShooterWeapon>(WeaponClass, SpawnInfo);
+}
+
+
+void UShooterWeaponPoolSubsystem::ReleaseWeapon(AShooterWeapon* Weapon)
+{
+	if (!IsValid(Weapon))
+	{
+		return;
+	}
+
+	FShooterWeaponPool& Pool = Pools.FindOrAdd(Weapon->GetClass());
+	if (GetWorld()->bIsTearingDown || Pool.Weapons.Num() >= WeaponPoolSize)
+	{
+		Weapon->Destroy();
+		return;
+	}
+
+	Weapon->OnEnterPool();
+	Pool.Weapons.Add(Weapon);
+}
+
+
+void UShooterWeaponPoolSubsystem::Deinitialize()
+{
+	Pools.Reset();
+
+	Super::Deinitialize();
+}
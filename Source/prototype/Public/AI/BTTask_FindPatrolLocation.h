@@ -6,8 +6,17 @@
 #include "BehaviorTree/Tasks/BTTask_BlackboardBase.h"
 #include "BTTask_FindPatrolLocation.generated.h"
 
+
+struct FBTFindPatrolLocationMemory
+{
+	/* Pending query in the navigation query subsystem (0 when none) */
+	uint32 RequestId;
+};
+
+
 /**
 * Blackboard Task - Finds a position to a nearby waypoint
+* The query is queued with the navigation query subsystem, the task stays in progress until the result arrives.
 */
 UCLASS()
 class PROTOTYPE_API UBTTask_FindPatrolLocation : public UBTTask_BlackboardBase
@@ -16,4 +25,10 @@ class PROTOTYPE_API UBTTask_FindPatrolLocation : public UBTTask_BlackboardBase
 
 	virtual EBTNodeResult::Type ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
 
+	virtual EBTNodeResult::Type AbortTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+
+	virtual uint16 GetInstanceMemorySize() const override;
+
+	/* The task object is shared by all AI using the tree, so the owner is passed along with the result */
+	void OnPatrolLocationFound(bool bSuccess, const FVector& Location, TWeakObjectPtr<UBehaviorTreeComponent> OwnerComp);
 };
@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+
+
+DECLARE_STATS_GROUP(TEXT("ShooterAI"), STATGROUP_ShooterAI, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("AI Logic"), STAT_ShooterAI_Logic, STATGROUP_ShooterAI, PROTOTYPE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("AI Navigation"), STAT_ShooterAI_Navigation, STATGROUP_ShooterAI, PROTOTYPE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("AI Movement"), STAT_ShooterAI_Movement, STATGROUP_ShooterAI, PROTOTYPE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("AI Perception"), STAT_ShooterAI_Perception, STATGROUP_ShooterAI, PROTOTYPE_API);
+
+
+/* Cost categories recorded for AI pawns. Scopes of different categories must not be nested or their time is counted twice. */
+enum class EShooterAIStat : uint8
+{
+	Logic,
+	Navigation,
+	Movement,
+	Perception,
+
+	Count
+};
+
+
+/**
+* Accumulates wall-clock time per AI category. Unlike the cycle stats above this also works in Test builds and without "stat" commands,
+* which lets the AI benchmark read the per-frame cost on a headless (-nullrhi) server.
+*/
+struct PROTOTYPE_API FShooterAIStats
+{
+	/* Accumulation is off by default so regular play pays nothing but a branch per scope */
+	static void SetEnabled(bool bEnable);
+
+	static bool IsEnabled();
+
+	static void Accumulate(EShooterAIStat Stat, double Seconds);
+
+	/* Return the milliseconds accumulated since the last call and reset the counters */
+	static void ConsumeFrame(double OutMilliseconds[(int32)EShooterAIStat::Count]);
+
+	static const TCHAR* GetName(EShooterAIStat Stat);
+
+private:
+
+	static bool bEnabled;
+
+	static double AccumulatedSeconds[(int32)EShooterAIStat::Count];
+};
+
+
+/* Adds the time spent in the current scope to the given AI category */
+class FShooterAIScopeTimer
+{
+public:
+
+	explicit FShooterAIScopeTimer(EShooterAIStat InStat)
+		: Stat(InStat),
+		StartTime(FShooterAIStats::IsEnabled() ? FPlatformTime::Seconds() : 0.0)
+	{}
+
+	~FShooterAIScopeTimer()
+	{
+		if (StartTime > 0.0)
+		{
+			FShooterAIStats::Accumulate(Stat, FPlatformTime::Seconds() - StartTime);
+		}
+	}
+
+private:
+
+	EShooterAIStat Stat;
+
+	double StartTime;
+};
+
+
+/* Usage: SHOOTER_AI_SCOPE(Navigation); records both the cycle stat and the benchmark counter */
+#define SHOOTER_AI_SCOPE(Category) \
+	SCOPE_CYCLE_COUNTER(STAT_ShooterAI_##Category); \
+	FShooterAIScopeTimer ANONYMOUS_VARIABLE(ShooterAIScope_)(EShooterAIStat::Category)
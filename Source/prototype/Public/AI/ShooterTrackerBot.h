@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Pawn.h"
+#include "../ShooterTypes.h"
 #include "ShooterTrackerBot.generated.h"
 
 class UShooterHealthComponent;
@@ -23,6 +24,16 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/* Scale net updates and path refreshes with the importance to the players */
+	void OnSignificanceChanged(EShooterSignificance OldSignificance, EShooterSignificance NewSignificance);
+
+	float DefaultNetUpdateFrequency;
+
+	/* Seconds before the path to the target is searched again */
+	float PathRefreshInterval;
+
 	UPROPERTY(VisibleDefaultsOnly, Category = "Components")
 	UStaticMeshComponent* MeshComp;
 
@@ -36,11 +47,22 @@ protected:
 	void HandleTakeDamage(UShooterHealthComponent* OwningHealthComp, float Health, float HealthDelta, const class UDamageType* DamageType
 		, class AController* InstigatedBy, AActor* DamageCauser);
 
-	FVector GetNextPathPoint();
+	/* Queue a path query towards the nearest enemy, NextPathPoint is updated in OnPathFound */
+	void RequestNextPathPoint();
+
+	void OnPathFound(bool bSuccess, const TArray<FVector>& PathPoints);
 
 	//Next point in navigation path
 	FVector NextPathPoint;
 
+	/* Path to the current target, NextPathPoint is CurrentPath[CurrentPathIndex] while following it */
+	TArray<FVector> CurrentPath;
+
+	int32 CurrentPathIndex;
+
+	/* Pending path query (0 when none) */
+	uint32 PathRequestId;
+
 	UPROPERTY(EditDefaultsOnly, Category = "TrackerBot")
 	float MovementForce;
 
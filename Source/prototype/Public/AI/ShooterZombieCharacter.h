@@ -7,6 +7,7 @@
 #include "ShooterZombieCharacter.generated.h"
 
 class USoundCue;
+class USoundConcurrency;
 
 UCLASS(ABSTRACT)
 class PROTOTYPE_API AShooterZombieCharacter : public AShooterBaseCharacter
@@ -30,10 +31,12 @@ class PROTOTYPE_API AShooterZombieCharacter : public AShooterBaseCharacter
 	bool bSensedTarget;
 
 	UPROPERTY(VisibleAnywhere, Category = "AI")
-	class UPawnSensingComponent* PawnSensingComp;
+	class UShooterPawnSensingComponent* PawnSensingComp;
 
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	virtual void Tick(float DeltaSeconds) override;
 
 protected:
@@ -48,15 +51,31 @@ protected:
 	UFUNCTION()
 	void OnHearNoise(APawn* PawnInstigator, const FVector& Location, float Volume);
 
-	/* Deal damage to the Actor that was hit by the punch animation */
+	/* Deal damage to the Actor that was hit by the punch animation. Ignored while the melee trace sweeps the strike */
 	UFUNCTION(BlueprintCallable, Category = "Attacking")
 	void PerformMeleeStrike(AActor* HitActor);
 
+	/* Every actor is damaged at most once per strike, by the overlap or by the melee trace */
+	void DealMeleeDamage(AActor* HitActor);
+
+	/* Server: actors damaged since the last strike started */
+	TArray<TWeakObjectPtr<AActor>, TInlineAllocator<4>> MeleeStrikeHitActors;
+
 	UFUNCTION(BlueprintCallable, Reliable, NetMulticast)
 	void SimulateMeleeStrike();
 
 	void SimulateMeleeStrike_Implementation();
 
+	/* Sweeps the hands of the mesh during the strike, the overlap of the Blueprint is used while its sockets aren't set up */
+	UPROPERTY(VisibleAnywhere, Category = "Attacking")
+	class UShooterMeleeTraceComponent* MeleeTraceComp;
+
+	/* Time after the start of the strike animation during which the hands deal damage */
+	UPROPERTY(EditDefaultsOnly, Category = "Attacking")
+	float MeleeSwingDuration;
+
+	void OnMeleeTraceHit(const FHitResult& Hit);
+
 	UPROPERTY(EditDefaultsOnly, Category = "Attacking")
 	TSubclassOf<UDamageType> PunchDamageType;
 
@@ -66,11 +85,31 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "Attacking")
 	UAnimMontage* MeleeAnimMontage;
 
-	/* Update the vocal loop of the zombie (idle, wandering, hunting) */
-	UFUNCTION(Reliable, NetMulticast)
-	void BroadcastUpdateAudioLoop(bool bNewSensedTarget);
+	/* The vocal loop of the zombie (idle, wandering, hunting). Replicated so clients only touch the loop when the state actually changes. */
+	UPROPERTY(Transient, ReplicatedUsing = OnRep_AudioLoopState)
+	EZombieAudioState AudioLoopState;
+
+	UFUNCTION()
+	void OnRep_AudioLoopState(EZombieAudioState PreviousState);
 
-	void BroadcastUpdateAudioLoop_Implementation(bool bNewSensedTarget);
+	/* Server-side: pick the vocal loop matching the sensing state and bot type */
+	void UpdateAudioLoopState();
+
+	/* Start, swap or stop the looped sound to match AudioLoopState (not on dedicated servers) */
+	void ApplyAudioLoop(EZombieAudioState PreviousState);
+
+	USoundCue* GetAudioLoopSound(EZombieAudioState State) const;
+
+	/* Loop is stopped because the zombie is not significant enough to the local viewer */
+	bool bAudioLoopCulled;
+
+	/* Scale tick rates, sensing, net updates, animation and audio with the importance to the viewers */
+	void OnSignificanceChanged(EShooterSignificance OldSignificance, EShooterSignificance NewSignificance);
+
+	/* Class defaults, the significance tiers scale these down */
+	float DefaultNetUpdateFrequency;
+
+	float DefaultSensingInterval;
 
 	UAudioComponent* PlayCharacterSound(USoundCue* CueToPlay);
 
@@ -93,6 +132,10 @@ protected:
 	UPROPERTY(VisibleAnywhere, Category = "Sound")
 	UAudioComponent* AudioLoopComp;
 
+	/* Voice budget shared by all zombie loops (eg. MaxCount 8 with StopFarthestThenOldest) */
+	UPROPERTY(EditDefaultsOnly, Category = "Sound")
+	USoundConcurrency* AudioLoopConcurrency;
+
 	virtual void PlayHit(float DamageTaken, struct FDamageEvent const& DamageEvent, APawn* PawnInstigator, AActor* DamageCauser, bool bKilled) override;
 
 public:
@@ -0,0 +1,120 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Engine/NetSerialization.h"
+#include "../ShooterTypes.h"
+#include "ShooterInventoryComponent.generated.h"
+
+class AShooterWeapon;
+class UShooterInventoryComponent;
+
+
+/* One inventory slot, exists for every slot whether it holds a weapon or not */
+USTRUCT()
+struct FShooterInventorySlot : public FFastArraySerializerItem
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+	EInventorySlot Slot;
+
+	UPROPERTY()
+	AShooterWeapon* Weapon;
+
+	FShooterInventorySlot()
+		: Slot(EInventorySlot::Hands)
+		, Weapon(nullptr)
+	{
+	}
+};
+
+
+/* Fixed set of slots, a weapon entering or leaving only sends its own slot */
+USTRUCT()
+struct FShooterInventoryArray : public FFastArraySerializer
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+	TArray<FShooterInventorySlot> Items;
+
+	/* Not replicated, set by the owning component */
+	UShooterInventoryComponent* Owner;
+
+	FShooterInventoryArray()
+		: Owner(nullptr)
+	{
+	}
+
+	void PostReplicatedReceive(const FFastArraySerializer::FPostReplicatedReceiveParameters& Parameters);
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FShooterInventorySlot, FShooterInventoryArray>(Items, DeltaParms, *this);
+	}
+};
+
+
+template<>
+struct TStructOpsTypeTraits<FShooterInventoryArray> : public TStructOpsTypeTraitsBase2<FShooterInventoryArray>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
+
+/**
+* Weapons held by a character, one per EInventorySlot. Slot queries are an index lookup, changes are replicated as fast array deltas.
+* Only the server adds and removes weapons.
+*/
+UCLASS( ClassGroup=(PROTOTYPE), meta=(BlueprintSpawnableComponent) )
+class PROTOTYPE_API UShooterInventoryComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	UShooterInventoryComponent();
+
+	static const int32 NumSlots = (int32)EInventorySlot::Katana + 1;
+
+	/* Returns false when the storage slot of the weapon is taken */
+	bool AddWeapon(AShooterWeapon* Weapon);
+
+	/* Returns false when the weapon is not in the inventory */
+	bool RemoveWeapon(AShooterWeapon* Weapon);
+
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	AShooterWeapon* GetWeapon(EInventorySlot Slot) const;
+
+	bool IsSlotAvailable(EInventorySlot Slot) const;
+
+	bool Contains(AShooterWeapon* Weapon) const;
+
+	int32 GetNumWeapons() const;
+
+	/* Weapon in the lowest occupied slot */
+	AShooterWeapon* GetFirstWeapon() const;
+
+	/* Next weapon after From in slot order (Direction -1 for the previous one), wraps around */
+	AShooterWeapon* GetAdjacentWeapon(AShooterWeapon* From, int32 Direction) const;
+
+	/* Rebuild the slot lookup after the client received slot changes */
+	void OnSlotsReceived();
+
+private:
+
+	/* Server: create the entry of every slot before the first weapon is added */
+	void InitializeSlots();
+
+	UPROPERTY(Replicated)
+	FShooterInventoryArray Slots;
+
+	/* Item index in Slots for every slot. Identity on the server, clients may receive the items in a different order */
+	int8 SlotToItem[NumSlots];
+};
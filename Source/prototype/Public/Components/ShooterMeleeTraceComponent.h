@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "ShooterMeleeTraceComponent.generated.h"
+
+class USkeletalMeshComponent;
+
+/* Called once per actor and swing, with the first hit on that actor */
+DECLARE_DELEGATE_OneParam(FShooterMeleeHitSignature, const FHitResult& /* Hit */);
+
+
+/**
+* Swept melee hit detection. While a swing is active the blade (a capsule between two sockets of the animated mesh) is swept
+* from its pose of the last frame to the current one, so the montage drives the traced arc. Fast swings at low frame rates are
+* sub-stepped by blending the socket transforms between both poses. Every sub-step is one multi sweep, hits are deduplicated per swing.
+*/
+UCLASS( ClassGroup=(PROTOTYPE), meta=(BlueprintSpawnableComponent) )
+class PROTOTYPE_API UShooterMeleeTraceComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	UShooterMeleeTraceComponent();
+
+	/* Trace the sockets of Mesh for Duration seconds. Does nothing when the sockets are not set up */
+	void StartSwing(USkeletalMeshComponent* Mesh, float Duration);
+
+	void StopSwing();
+
+	bool IsSwinging() const;
+
+	FShooterMeleeHitSignature OnMeleeHit;
+
+	/* The blade runs from the start to the end socket, use the same socket for a fist */
+	UPROPERTY(EditDefaultsOnly, Category = "Melee")
+	FName BladeStartSocket;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Melee")
+	FName BladeEndSocket;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Melee")
+	float TraceRadius;
+
+	/* A blade end moving further than this within a frame is swept in several steps */
+	UPROPERTY(EditDefaultsOnly, Category = "Melee")
+	float MaxSubstepDistance;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Melee")
+	int32 MaxSubsteps;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Melee")
+	TEnumAsByte<ECollisionChannel> TraceChannel;
+
+protected:
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+private:
+
+	struct FBladePose
+	{
+		FTransform ComponentTransform;
+
+		/* Component space, blended between poses so sub-steps follow the arc of the swing */
+		FTransform StartSocket;
+
+		FTransform EndSocket;
+	};
+
+	FBladePose SamplePose() const;
+
+	/* Sweep the blade from one pose to the next, reports actors not hit before during this swing */
+	void SweepBlade(const FBladePose& From, const FBladePose& To);
+
+	TWeakObjectPtr<USkeletalMeshComponent> SwingMesh;
+
+	FBladePose LastPose;
+
+	float SwingEndTime;
+
+	TArray<TWeakObjectPtr<AActor>, TInlineAllocator<8>> HitActors;
+};
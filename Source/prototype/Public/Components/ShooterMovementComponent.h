@@ -15,4 +15,6 @@ class PROTOTYPE_API UShooterMovementComponent : public UCharacterMovementCompone
 	GENERATED_BODY()
 	
 	virtual float GetMaxSpeed() const override;
+
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
 };
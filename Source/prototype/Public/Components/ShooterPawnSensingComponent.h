@@ -0,0 +1,20 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Perception/PawnSensingComponent.h"
+#include "ShooterPawnSensingComponent.generated.h"
+
+/**
+ * Pawn sensing that reports its cost to the AI perception stats
+ */
+UCLASS(ClassGroup=(PROTOTYPE), meta=(BlueprintSpawnableComponent))
+class PROTOTYPE_API UShooterPawnSensingComponent : public UPawnSensingComponent
+{
+	GENERATED_BODY()
+
+protected:
+
+	virtual void UpdateAISensing() override;
+};
@@ -0,0 +1,52 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/SphereComponent.h"
+#include "ShooterUsableFocusComponent.generated.h"
+
+class AShooterUsableActor;
+
+
+/**
+* Usable actor focus of a locally controlled character. The sphere collects the usable actors in reach through overlap events,
+* the view trace only runs (at FocusUpdateInterval) while one of them is nearby. The result is cached for the HUD and the Use input.
+*/
+UCLASS( ClassGroup=(PROTOTYPE), meta=(BlueprintSpawnableComponent) )
+class PROTOTYPE_API UShooterUsableFocusComponent : public USphereComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	UShooterUsableFocusComponent();
+
+	/* Usable actor in view as of the last update, null for pawns that aren't locally controlled */
+	AShooterUsableActor* GetFocusedActor() const;
+
+	/* Seconds between focus updates */
+	UPROPERTY(EditDefaultsOnly, Category = "ObjectInteraction")
+	float FocusUpdateInterval;
+
+protected:
+
+	virtual void BeginPlay() override;
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	UFUNCTION()
+	void OnUsableBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
+
+	UFUNCTION()
+	void OnUsableEndOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex);
+
+private:
+
+	/* Calls the end and begin focus events when the focus moves to another actor */
+	void SetFocusedActor(AShooterUsableActor* NewFocus);
+
+	TArray<TWeakObjectPtr<AShooterUsableActor>, TInlineAllocator<4>> NearbyUsables;
+
+	TWeakObjectPtr<AShooterUsableActor> FocusedActor;
+};
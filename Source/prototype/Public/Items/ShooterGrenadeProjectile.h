@@ -10,6 +10,7 @@
 class USphereComponent;
 class UProjectileMovementComponent;
 class URadialForceComponent;
+class UStaticMesh;
 
 
 UCLASS()
@@ -42,6 +43,10 @@ public:
 	/** Returns ProjectileMovement subobject **/
 	UProjectileMovementComponent* GetProjectileMovement() const { return ProjectileMovement; }
 
+	/** Drawn while the grenade is simulated without its actor, leave empty to always spawn the actor **/
+	UPROPERTY(EditDefaultsOnly, Category = Projectile)
+	UStaticMesh* SimulationMesh;
+
 protected:
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
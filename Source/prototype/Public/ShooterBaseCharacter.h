@@ -12,6 +12,7 @@ class UPawnNoiseEmitterComponent;
 class UShooterHealthComponent;
 class USoundCue;
 class ADecalActor;
+struct FShooterQueuedHit;
 
 
 UCLASS()
@@ -75,6 +76,8 @@ protected:
 
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	UPROPERTY(EditDefaultsOnly, Category = "Movement")
 	float SprintingSpeedModifier;
 
@@ -101,11 +104,19 @@ protected:
 	/************************************************************************/
 	/* Damage & Death                                                       */
 	/************************************************************************/
+public:
+
+	/* Apply the hits taken within the last frame, summed up per source */
+	void ApplyQueuedDamage(TArrayView<const FShooterQueuedHit> Hits);
+
 protected:
 
-	/* Take damage & handle death */
+	/* Take damage & handle death, queued until the end of the frame on the server */
 	virtual float TakeDamage(float Damage, struct FDamageEvent const& DamageEvent, class AController* EventInstigator, class AActor* DamageCauser) override;
 
+	/* Apply game mode rules and health change, handle death or play the hit */
+	float ApplyDamage(float Damage, struct FDamageEvent const& DamageEvent, class AController* EventInstigator, class AActor* DamageCauser);
+
 	virtual bool CanDie(float KillingDamage, FDamageEvent const& DamageEvent, AController* Killer, AActor* DamageCauser) const;
 
 	virtual bool Die(float KillingDamage, FDamageEvent const& DamageEvent, AController* Killer, AActor* DamageCauser);
@@ -153,14 +164,38 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "Footprint")
 	FName LeftFootSocketName;
 
-	void TraceFootprint(FHitResult& OutHit, const FVector& Location) const;
+	/* Used when the footprint decal actor sets neither an initial life span nor a fade out */
+	UPROPERTY(EditDefaultsOnly, Category = "Footprint")
+	float FootprintLifeSpan;
+
+	/* Floors with several surfaces (landscapes, meshes with more than one material) have their surface looked up again after this distance */
+	UPROPERTY(EditDefaultsOnly, Category = "Footprint")
+	float FootstepSurfaceRefreshDistance;
 
-	void SpawnFootprint(UArrowComponent* FootArrow, TSubclassOf<AActor> FootprintDecal) const;
+	/* Queues the step with the footstep subsystem, which traces and places the footprint */
+	void SpawnFootprint(UArrowComponent* FootArrow, TSubclassOf<AActor> FootprintDecal);
+
+	/* Surface of the floor last traced for a footprint, kept until the character stands on another floor component */
+	TWeakObjectPtr<UPrimitiveComponent> FootstepFloor;
+
+	/* Where the surface was traced */
+	FVector FootstepSurfaceLocation;
+
+	TEnumAsByte<EPhysicalSurface> FootstepSurface;
 
 public:
 	UFUNCTION(BlueprintCallable, Category = "Footprint")
-	void RightFootDown() const;
+	void RightFootDown();
 
 	UFUNCTION(BlueprintCallable, Category = "Footprint")
-	void LeftFootDown() const;
+	void LeftFootDown();
+
+	/* Cached surface under the feet, e.g. to pick footstep sounds */
+	UFUNCTION(BlueprintCallable, Category = "Footprint")
+	TEnumAsByte<EPhysicalSurface> GetFootstepSurface() const;
+
+	/* The cached surface is still valid for a step at FootLocation on Floor */
+	bool HasFootstepSurface(const UPrimitiveComponent* Floor, const FVector& FootLocation) const;
+
+	void SetFootstepSurface(UPrimitiveComponent* Floor, const FVector& FootLocation, EPhysicalSurface Surface);
 };
@@ -137,14 +137,15 @@ public:
 
 	AShooterUsableActor* GetUsableInView() const;
 
+	/* Usable actor in focus as of the last focus update, only set for locally controlled characters */
+	AShooterUsableActor* GetFocusedUsable() const;
+
 	/*Max distance to use/focus on actors. */
 	UPROPERTY(EditDefaultsOnly, Category = "ObjectInteraction")
 	float MaxUseDistance;
 
-	/* True only in first frame when focused on a new usable actor. */
-	bool bHasNewFocus;
-
-	AShooterUsableActor* FocusedUsableActor;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
+	class UShooterUsableFocusComponent* UsableFocusComp;
 
 protected:
 
@@ -241,9 +242,9 @@ public:
 	void SetCurrentWeapon(AShooterWeapon* newWeapon, AShooterWeapon* LastWeapon = nullptr);
 
 
-	/* All weapons/items the player currently holds */
-	UPROPERTY(Transient, Replicated)
-	TArray<AShooterWeapon*> Inventory;
+	/* All weapons/items the player currently holds, one per storage slot */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
+	class UShooterInventoryComponent* InventoryComp;
 
 	/* Check if the specified slot is available, limited to one item per type (primary, secondary) */
 	bool WeaponSlotAvailable(EInventorySlot CheckSlot);
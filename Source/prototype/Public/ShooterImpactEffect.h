@@ -10,22 +10,22 @@
 class USoundCue;
 
 
+/**
+* Effect set for bullet impacts. Only the class defaults are used, impacts are played by UShooterEffectsSubsystem
+* from pooled components instead of spawning this actor per hit.
+*/
 UCLASS(ABSTRACT, Blueprintable)
 class PROTOTYPE_API AShooterImpactEffect : public AActor
 {
 	GENERATED_BODY()
-	
-protected:
-
-	UParticleSystem* GetImpactFX(EPhysicalSurface SurfaceType) const;
-
-	USoundCue* GetImpactSound(EPhysicalSurface SurfaceType) const;
 
 public:
 
 	AShooterImpactEffect();
 
-	virtual void PostInitializeComponents() override;
+	UParticleSystem* GetImpactFX(EPhysicalSurface SurfaceType) const;
+
+	USoundCue* GetImpactSound(EPhysicalSurface SurfaceType) const;
 
 	/* FX spawned on standard materials */
 	UPROPERTY(EditDefaultsOnly)
@@ -55,6 +55,4 @@ public:
 	UPROPERTY(EditDefaultsOnly, Category = "Decal")
 	float DecalLifeSpan;
 
-	FHitResult SurfaceHit;
-
 };
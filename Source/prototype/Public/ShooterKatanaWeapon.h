@@ -6,6 +6,8 @@
 #include "ShooterWeapon.h"
 #include "ShooterKatanaWeapon.generated.h"
 
+class UShooterMeleeTraceComponent;
+
 /**
  * 
  */
@@ -18,6 +20,49 @@ protected:
 
 	AShooterKatanaWeapon();
 
+	virtual void PostInitializeComponents() override;
+
+	/* Opens the hit window of the swing, the fire animation moves the blade */
 	virtual void FireWeapon() override;
 
+	virtual void OnEnterPool() override;
+
+	/* Server: the swings of remote clients open the window their hits are accepted in */
+	virtual void HandleFiring() override;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
+	UShooterMeleeTraceComponent* MeleeTraceComp;
+
+	/* Time after the start of a swing during which the blade deals damage */
+	UPROPERTY(EditDefaultsOnly, Category = "Melee")
+	float SwingDuration;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Melee")
+	float HitDamage;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Melee")
+	TSubclassOf<UDamageType> DamageType;
+
+	/* Hit verification: farthest a client hit may be from the pawn as the server sees it */
+	UPROPERTY(EditDefaultsOnly, Category = "Melee")
+	float MaxHitReach;
+
+	void OnMeleeHit(const FHitResult& Hit);
+
+	void DealMeleeDamage(const FHitResult& Hit);
+
+	/* ClientTimestamp is the server world time as estimated by the client, hits on characters are checked against their hitboxes at that time */
+	UFUNCTION(Reliable, Server, WithValidation)
+	void ServerNotifyMeleeHit(const FHitResult Hit, float ClientTimestamp);
+	void ServerNotifyMeleeHit_Implementation(const FHitResult Hit, float ClientTimestamp);
+	bool ServerNotifyMeleeHit_Validate(const FHitResult Hit, float ClientTimestamp);
+
+	bool ValidateMeleeHit(const FHitResult& Hit, float ClientTimestamp, FHitResult& OutHit) const;
+
+	/* Server: actors damaged during the current swing window, each one is only hit once per swing */
+	TArray<TWeakObjectPtr<AActor>, TInlineAllocator<8>> ServerSwingHitActors;
+
+	float ServerSwingStartTime;
+
+	float ServerSwingEndTime;
 };
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "WorldCollision.h"
 #include "ShooterCharacter.h"
 #include "ShooterWeapon.generated.h"
 
@@ -27,6 +28,30 @@ enum class EWeaponType
 };
 
 
+/* Ammo as the server sees it, together with the last client shot it has accounted for */
+USTRUCT()
+struct FShooterAmmoState
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+	int32 Ammo;
+
+	UPROPERTY()
+	int32 AmmoInClip;
+
+	UPROPERTY()
+	uint16 ShotSequence;
+
+	FShooterAmmoState()
+		: Ammo(0)
+		, AmmoInClip(0)
+		, ShotSequence(0)
+	{
+	}
+};
+
+
 class USkeletalMeshComponent;
 class UDamageType;
 class UParticleSystem;
@@ -40,8 +65,6 @@ class PROTOTYPE_API AShooterWeapon : public AActor
 {
 	GENERATED_BODY()
 
-	virtual void PostInitializeComponents() override;
-
 	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 	float GetEquipStartedTime() const;
@@ -58,8 +81,6 @@ class PROTOTYPE_API AShooterWeapon : public AActor
 
 	bool bPendingEquip;
 
-	FTimerHandle TimerHandle_HandleFiring;
-
 	FTimerHandle TimerHandle_EquipFinished;
 
 	FTimerHandle TimerHandle_UnEquipFinished;
@@ -67,6 +88,10 @@ class PROTOTYPE_API AShooterWeapon : public AActor
 	UPROPERTY(EditDefaultsOnly, Category = "Weapon")
 	float ShotsPerMinute;
 
+	/* Cap for shots that became due within one frame, more than that (hitches) are dropped instead of fired as a burst */
+	UPROPERTY(EditDefaultsOnly, Category = "Weapon")
+	int32 MaxShotsPerFrame;
+
 protected:
 
 	EWeaponType WeaponType;
@@ -122,6 +147,12 @@ public:
 
 	virtual void OnLeaveInventory();
 
+	/* Weapon pool: reset to a freshly spawned weapon and park the actor dormant, called after it left its inventory */
+	virtual void OnEnterPool();
+
+	/* Weapon pool: wake the actor up again before it is added to the next inventory */
+	virtual void OnLeavePool();
+
 	FORCEINLINE EInventorySlot GetStorageSlot()
 	{
 		return StorageSlot;
@@ -138,6 +169,8 @@ public:
 
 protected:
 
+	virtual void PostInitializeComponents() override;
+
 	virtual void BeginPlay() override;
 
 	UPROPERTY(EditDefaultsOnly, Category = "Weapon")
@@ -160,39 +193,82 @@ public:
 
 protected:
 
+	/* Fires a round locally, on the server it also accounts for the rounds of remote clients */
+	virtual void HandleFiring();
+
 	bool CanFire() const;
 
+	float GetTimeBetweenShots() const;
+
 	FVector GetAdjustedAim() const;
 
 	FVector GetCameraDamageStartLocation(const FVector& AimDir) const;
 
 	FHitResult WeaponTrace(const FVector& TraceFrom, const FVector& TraceTo) const;
 
+	/* Same query as WeaponTrace, run by the async trace system. The delegate is called at the start of the next frame */
+	FTraceHandle AsyncWeaponTrace(const FVector& TraceFrom, const FVector& TraceTo, FTraceDelegate* Delegate, uint32 UserData) const;
+
+	FCollisionQueryParams GetWeaponTraceParams() const;
+
 	/* With PURE_VIRTUAL we skip implementing the function in SWeapon.cpp and can do this in SWeaponInstant.cpp / SFlashlight.cpp instead */
 	virtual void FireWeapon() PURE_VIRTUAL(AShooterWeapon::FireWeapon, );
 
+	/* Weapons that report their shots to the server themselves don't send the fire state (ServerNotifyFired) */
+	virtual bool UsesBatchedShotReports() const;
+
+	/* Server side bookkeeping of one shot fired by a remote client, returns false if the weapon could not have fired */
+	bool ConsumeServerShot();
+
+	/* Server: charge every shot up to ShotSequence that hasn't been accounted for yet (lost reports, stop fire) */
+	void AcknowledgeShots(uint16 ShotSequence);
+
+	/* Shots up to ShotSequence the server hasn't accounted for, negative for sequences it already has */
+	int32 GetUnacknowledgedShots(uint16 ShotSequence) const;
+
+	/* Send the shots fired so far to the server, called the frame after firing and before the server is told to stop */
+	virtual void FlushShotReports();
+
+	/* Client: shots fired and predicted locally. Wraps around, compare through GetUnacknowledgedShots */
+	uint16 LocalShotSequence;
+
+	/* Server: client shots accounted for */
+	uint16 AckedShotSequence;
+
+	/* Server: bit N set when shot AckedShotSequence - N was accepted by ConsumeServerShot and its hits haven't been reported yet */
+	uint64 AcceptedShotMask;
+
+	/* Server: true once for a shot that was accepted, rejected and forgiven shots never have hits to apply */
+	bool ClaimAcceptedShot(uint16 ShotSequence);
+
+	/* Shot time in the lag compensation clock, shots fired by the scheduler are moved back to when they were due within the frame */
+	float GetShotTimestamp() const;
+
 private:
 
 	void SetWeaponState(EWeaponState NewState);
 
 	void DetermineWeaponState();
 
-	virtual void HandleFiring();
-
 	UFUNCTION(Reliable, Server, WithValidation)
 	void ServerStartFire();
 	void ServerStartFire_Implementation();
 	bool ServerStartFire_Validate();
 
+	/* Carries the last shot fired so the server charges shots whose unreliable reports got lost */
 	UFUNCTION(Reliable, Server, WithValidation)
-	void ServerStopFire();
-	void ServerStopFire_Implementation();
-	bool ServerStopFire_Validate();
+	void ServerStopFire(uint16 ShotSequence);
+	void ServerStopFire_Implementation(uint16 ShotSequence);
+	bool ServerStopFire_Validate(uint16 ShotSequence);
 
-	UFUNCTION(Reliable, Server, WithValidation)
-	void ServerHandleFiring();
-	void ServerHandleFiring_Implementation();
-	bool ServerHandleFiring_Validate();
+	/* Fire state of weapons without batched shot reports, at most one per frame. Unreliable: the next one or ServerStopFire acknowledges the lost shots */
+	UFUNCTION(Unreliable, Server, WithValidation)
+	void ServerNotifyFired(uint16 ShotSequence);
+	void ServerNotifyFired_Implementation(uint16 ShotSequence);
+	bool ServerNotifyFired_Validate(uint16 ShotSequence);
+
+	/* Shots were fired this frame that still have to be sent with ServerNotifyFired */
+	bool bFireStatePending;
 
 	void OnBurstStarted();
 
@@ -209,6 +285,22 @@ private:
 	/* Time between shots for repeating fire */
 	float TimeBetweenShots;
 
+	/* Fire scheduler: the weapon ticks while a shot is pending and fires every shot that became due during the frame */
+	virtual void Tick(float DeltaSeconds) override;
+
+	void ScheduleNextShot();
+
+	bool bFireScheduled;
+
+	/* Time passed since the last shot was due */
+	float FireTimeAccumulator;
+
+	/* Frame the burst started in, its time is already part of the accumulator */
+	uint64 BurstStartFrame;
+
+	/* How long ago (within the current frame) the shot being fired was due */
+	float CurrentShotTimeOffset;
+
 
 	/************************************************************************/
 	/* Simulation & FX                                                      */
@@ -289,12 +381,26 @@ protected:
 
 	void UseAmmo();
 
-	UPROPERTY(Transient, Replicated)
+	/* Predicted on the owning client, authoritative on the server */
 	int32 CurrentAmmo;
 
-	UPROPERTY(Transient, Replicated)
 	int32 CurrentAmmoInClip;
 
+	/* Owner only. Updated periodically while the owner fires, right away for reloads and pickups */
+	UPROPERTY(Transient, ReplicatedUsing = OnRep_AuthoritativeAmmo)
+	FShooterAmmoState AuthoritativeAmmo;
+
+	/* Re-apply the shots the server hadn't seen yet on top of its ammo */
+	UFUNCTION()
+	void OnRep_AuthoritativeAmmo();
+
+	/* Server: publish the ammo to the owner, with the next periodic correction unless bImmediate */
+	void UpdateAuthoritativeAmmo(bool bImmediate);
+
+	void SendAmmoCorrection();
+
+	FTimerHandle TimerHandle_AmmoCorrection;
+
 	/* Weapon ammo on spawn */
 	UPROPERTY(EditDefaultsOnly)
 	int32 StartAmmo;
@@ -4,8 +4,193 @@
 
 #include "CoreMinimal.h"
 #include "ShooterWeapon.h"
+#include "Engine/NetSerialization.h"
 #include "ShooterWeaponInstant.generated.h"
 
+class AShooterWeaponInstant;
+
+
+UENUM()
+enum class EWeaponTraceMode : uint8
+{
+	/* Trace on the game thread while firing */
+	Sync,
+
+	/* Submit all pellet traces to the async trace system, damage and FX are applied next frame */
+	Async,
+};
+
+
+/* Designer override of how hits on one physical surface are resolved */
+USTRUCT(BlueprintType)
+struct FShooterSurfaceDamage
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(EditDefaultsOnly)
+	TEnumAsByte<EPhysicalSurface> SurfaceType;
+
+	UPROPERTY(EditDefaultsOnly)
+	float DamageMultiplier;
+
+	/* Flesh moves with its body, impact decals attach to it */
+	UPROPERTY(EditDefaultsOnly)
+	bool bIsFlesh;
+
+	/* Leave empty to use the weapon's ImpactTemplate */
+	UPROPERTY(EditDefaultsOnly)
+	TSubclassOf<class AShooterImpactEffect> ImpactTemplate;
+
+	FShooterSurfaceDamage()
+		: SurfaceType(SurfaceType_Default)
+		, DamageMultiplier(1.0f)
+		, bIsFlesh(false)
+	{
+	}
+};
+
+
+/* One shot fired by a client, several of them are sent to the server in a single batch */
+USTRUCT()
+struct FShooterShotRecord
+{
+	GENERATED_USTRUCT_BODY()
+
+	/* Server world time as estimated by the client when the shot was fired */
+	UPROPERTY()
+	float Timestamp;
+
+	UPROPERTY()
+	FVector_NetQuantize Origin;
+
+	UPROPERTY()
+	FVector_NetQuantizeNormal ShootDir;
+
+	/* Replicated actor that was hit, serialized as its net GUID */
+	UPROPERTY()
+	AActor* HitActor;
+
+	/* Additional pellet of the previous shot, the server doesn't consume ammo for it */
+	UPROPERTY()
+	bool bExtraPellet;
+
+	/* Body in the physics asset of HitActor's mesh, INDEX_NONE if no body was hit */
+	UPROPERTY()
+	int16 BodyIndex;
+
+	/* Distance from Origin to the impact in whole units, 0 for a miss */
+	UPROPERTY()
+	uint16 HitDistance;
+
+	/* Surface data of the client's trace so the server doesn't need to trace for effects, unused for misses */
+	UPROPERTY()
+	FVector_NetQuantizeNormal ImpactNormal;
+
+	UPROPERTY()
+	uint8 SurfaceType;
+
+	FShooterShotRecord()
+		: Timestamp(0.0f)
+		, Origin(ForceInit)
+		, ShootDir(ForceInit)
+		, HitActor(nullptr)
+		, bExtraPellet(false)
+		, BodyIndex(INDEX_NONE)
+		, HitDistance(0)
+		, ImpactNormal(ForceInit)
+		, SurfaceType(SurfaceType_Default)
+	{
+	}
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+
+template<>
+struct TStructOpsTypeTraits<FShooterShotRecord> : public TStructOpsTypeTraitsBase2<FShooterShotRecord>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
+
+
+/* Impact (or miss end point) of a shot confirmed by the server, replayed by remote clients */
+USTRUCT()
+struct FShooterImpactRecord : public FFastArraySerializerItem
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+	FVector_NetQuantize ImpactPoint;
+
+	/* Zero for misses, ImpactPoint is the end of the trail then */
+	UPROPERTY()
+	FVector_NetQuantizeNormal ImpactNormal;
+
+	UPROPERTY()
+	uint8 SurfaceType;
+
+	/* Wraps around, only compared against the last few records */
+	UPROPERTY()
+	uint8 Sequence;
+
+	FShooterImpactRecord()
+		: ImpactPoint(ForceInit)
+		, ImpactNormal(ForceInit)
+		, SurfaceType(SurfaceType_Default)
+		, Sequence(0)
+	{
+	}
+};
+
+
+/**
+* Fixed size ring of the most recent impacts of a weapon. Slots are overwritten in place so only changed records are sent,
+* remote clients replay every record newer than the last one they played, in sequence order.
+*/
+USTRUCT()
+struct FShooterImpactArray : public FFastArraySerializer
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+	TArray<FShooterImpactRecord> Items;
+
+	/* Not replicated, set by the owning weapon */
+	AShooterWeaponInstant* Owner;
+
+	/* Server only */
+	uint8 NextSequence;
+
+	FShooterImpactArray()
+		: Owner(nullptr)
+		, NextSequence(0)
+	{
+	}
+
+	void AddImpact(const FVector& ImpactPoint, const FVector& ImpactNormal, EPhysicalSurface SurfaceType);
+
+	void PostReplicatedReceive(const FFastArraySerializer::FPostReplicatedReceiveParameters& Parameters);
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FShooterImpactRecord, FShooterImpactArray>(Items, DeltaParms, *this);
+	}
+};
+
+
+template<>
+struct TStructOpsTypeTraits<FShooterImpactArray> : public TStructOpsTypeTraitsBase2<FShooterImpactArray>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
+
 /**
  * 
  */
@@ -20,9 +205,13 @@ private:
 	/* Visual Handlers                                                      */
 	/************************************************************************/
 
-	void SimulateInstantHit(const FVector& ImpactPoint);
+	/* Replay a replicated impact, only traces when the hit component is needed and not known */
+	void SimulateInstantHit(const FShooterImpactRecord& Record);
 
-	void SpawnImpactEffects(const FHitResult& Impact);
+	/* Local effects for a shot we have the full trace result of */
+	void SpawnShotEffects(const FHitResult& Impact, EPhysicalSurface SurfaceType);
+
+	void SpawnImpactEffects(const FHitResult& Impact, EPhysicalSurface SurfaceType);
 
 	void SpawnTrailEffects(const FVector& EndPoint);
 
@@ -59,29 +248,124 @@ protected:
 
 	virtual void FireWeapon() override;
 
+	/* Camera trace for the crosshair, then the muzzle trace towards its impact */
+	void FirePellet(const FVector& AimDir, const FVector& CameraPos, int32 PelletIndex, float ShotTimestamp);
+
+	/* Random direction within PelletSpread */
+	FVector GetPelletDirection(const FVector& AimDir) const;
+
 	void DealDamage(const FHitResult& Impact, const FVector& ShootDir);
 
+	/* Resolve the surface table once, hits only look up their entry */
+	virtual void PostInitializeComponents() override;
+
+	/* Shots of the previous owner are dropped */
+	virtual void OnEnterPool() override;
+
 	bool ShouldDealDamage(AActor* TestActor) const;
 
-	void ProcessInstantHit(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir);
+	/* Pellets after the first one of a shot don't consume ammo on the server, ShotTimestamp is reported for lag compensation */
+	void ProcessInstantHit(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir, int32 PelletIndex, float ShotTimestamp);
 
-	void ProcessInstantHitConfirmed(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir);
+	/* SurfaceType is passed separately because hits rebuilt from shot records have no physical material */
+	void ProcessInstantHitConfirmed(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir, EPhysicalSurface SurfaceType);
 
+	/* ClientTimestamp is the server world time as estimated by the client when the shot was fired, used to rewind the hit character */
 	UFUNCTION(Reliable, Server, WithValidation)
-	void ServerNotifyHit(const FHitResult Impact, FVector_NetQuantizeNormal ShootDir);
-	void ServerNotifyHit_Implementation(const FHitResult Impact, FVector_NetQuantizeNormal ShootDir);
-	bool ServerNotifyHit_Validate(const FHitResult Impact, FVector_NetQuantizeNormal ShootDir);
+	void ServerNotifyHit(const FHitResult Impact, FVector_NetQuantizeNormal ShootDir, float ClientTimestamp);
+	void ServerNotifyHit_Implementation(const FHitResult Impact, FVector_NetQuantizeNormal ShootDir, float ClientTimestamp);
+	bool ServerNotifyHit_Validate(const FHitResult Impact, FVector_NetQuantizeNormal ShootDir, float ClientTimestamp);
+
+	/* Hit verification shared by single and batched reports, OutImpact is the hit to apply when it returns true */
+	bool ValidateClientHit(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir, float ClientTimestamp, FHitResult& OutImpact) const;
+
+	/* Re-trace a client hit on a character against its hitboxes at the time of the shot, returns false if the hit is rejected */
+	bool ValidateRewoundHit(const FHitResult& Impact, const FVector& ShootDir, float ClientTimestamp, FHitResult& OutImpact) const;
 
 	UFUNCTION(Reliable, Server, WithValidation)
 	void ServerNotifyMiss(FVector_NetQuantizeNormal ShootDir);
 	void ServerNotifyMiss_Implementation(FVector_NetQuantizeNormal ShootDir);
 	bool ServerNotifyMiss_Validate(FVector_NetQuantizeNormal ShootDir);
 
-	UPROPERTY(Transient, ReplicatedUsing = OnRep_HitLocation)
-	FVector HitImpactNotify;
+	/* Play the trail of a missed shot on remote clients (server only) */
+	void ConfirmMiss(const FVector& ShootDir);
+
+	/************************************************************************/
+	/* Batched Shot Reports                                                 */
+	/************************************************************************/
+
+	virtual bool UsesBatchedShotReports() const override;
+
+	/* Shots fired during a frame are collected and sent with the next tick */
+	void QueueShotRecord(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir, int32 PelletIndex, float ShotTimestamp);
+
+	virtual void FlushShotReports() override;
+
+	/* Rebuild the client's hit from a received record */
+	FHitResult MakeImpactFromShotRecord(const FShooterShotRecord& Shot) const;
 
-	UFUNCTION()
-	void OnRep_HitLocation();
+	/**
+	* Unreliable: a lost batch only loses damage and FX. ShotSequence is the client's last shot, its rounds
+	* are charged by the next batch or by ServerStopFire.
+	*/
+	UFUNCTION(Unreliable, Server, WithValidation)
+	void ServerNotifyShots(const TArray<FShooterShotRecord>& Shots, uint16 ShotSequence);
+	void ServerNotifyShots_Implementation(const TArray<FShooterShotRecord>& Shots, uint16 ShotSequence);
+	bool ServerNotifyShots_Validate(const TArray<FShooterShotRecord>& Shots, uint16 ShotSequence);
+
+	TArray<FShooterShotRecord> PendingShotRecords;
+
+	/* Extra pellets the server still accepts for the last consumed shot */
+	int32 ServerPelletsRemaining;
+
+	/************************************************************************/
+	/* Async Traces                                                         */
+	/************************************************************************/
+
+	struct FPendingAsyncShot
+	{
+		uint32 ShotId;
+
+		/* Taken when fired, the results arrive a frame later */
+		float Timestamp;
+
+		FVector CameraPos;
+
+		FVector MuzzleOrigin;
+
+		TArray<FVector, TInlineAllocator<8>> TraceEnds;
+
+		TArray<FHitResult, TInlineAllocator<8>> Results;
+
+		int32 NumPending;
+	};
+
+	void FireWeaponAsync(const FVector& AimDir, const FVector& CameraPos, float ShotTimestamp);
+
+	void OnAsyncTraceComplete(const FTraceHandle& Handle, FTraceDatum& Datum);
+
+	/* All pellet traces of the shot came back, process them in pellet order */
+	void ResolveAsyncShot(FPendingAsyncShot& Shot);
+
+	TArray<FPendingAsyncShot> PendingAsyncShots;
+
+	FTraceDelegate AsyncTraceDelegate;
+
+	uint32 NextAsyncShotId;
+
+	/* Confirmed impacts for remote clients, several shots within one net update are all replayed */
+	UPROPERTY(Transient, Replicated)
+	FShooterImpactArray ReplicatedImpacts;
+
+	/* Sequence of the last replayed impact, INDEX_NONE until the first update was received */
+	int32 LastPlayedImpactSequence;
+
+public:
+
+	/* Called by ReplicatedImpacts after an update was received */
+	void OnImpactsReceived(bool bInitialUpdate);
+
+protected:
 
 	/************************************************************************/
 	/* Weapon Configuration                                                 */
@@ -93,15 +377,55 @@ protected:
 	UPROPERTY(EditDefaultsOnly)
 	TSubclassOf<class UDamageType> DamageType;
 
+	/* Surfaces that differ from the defaults. Flesh surfaces start with the head and limb modifiers of the damage type */
+	UPROPERTY(EditDefaultsOnly)
+	TArray<FShooterSurfaceDamage> SurfaceDamage;
+
+	struct FResolvedSurface
+	{
+		float DamageMultiplier;
+
+		bool bIsFlesh;
+
+		TSubclassOf<AShooterImpactEffect> ImpactTemplate;
+	};
+
+	/* Indexed by EPhysicalSurface, built from SurfaceDamage */
+	FResolvedSurface SurfaceTable[SurfaceType_Max];
+
+	const FResolvedSurface& GetSurface(EPhysicalSurface SurfaceType) const
+	{
+		return SurfaceTable[FMath::Clamp((int32)SurfaceType, 0, (int32)SurfaceType_Max - 1)];
+	}
+
+	/* Damage type and instigator don't change per hit */
+	FPointDamageEvent PointDamageEvent;
+
 	UPROPERTY(EditDefaultsOnly)
 	float WeaponRange;
 
+	/* Async spreads the trace cost of busy fights over the frame, at the cost of applying hits one frame later */
+	UPROPERTY(EditDefaultsOnly)
+	EWeaponTraceMode TraceMode;
+
+	/* Traces per shot, shotguns fire several pellets that only use one round */
+	UPROPERTY(EditDefaultsOnly, meta = (ClampMin = 1, ClampMax = 32))
+	int32 NumPellets;
+
+	/* Cone angle in degrees the pellets are spread over */
+	UPROPERTY(EditDefaultsOnly)
+	float PelletSpread;
+
 	/* Hit verification: threshold for dot product between view direction and hit direction */
 	UPROPERTY(EditDefaultsOnly)
 	float AllowedViewDotHitDir;
 
-	/* Hit verification: scale for bounding box of hit actor */
+	/* Hit verification: scale for bounding box of hit actor, only used for moving actors without lag compensation */
 	UPROPERTY(EditDefaultsOnly)
 	float ClientSideHitLeeway;
+
+	/* Hit verification: max distance between the trace start reported by the client and the muzzle on the server */
+	UPROPERTY(EditDefaultsOnly)
+	float ClientSideMuzzleLeeway;
 	
 };
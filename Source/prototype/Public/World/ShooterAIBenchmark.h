@@ -0,0 +1,193 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "AI/ShooterAIStats.h"
+#include "ShooterAIBenchmark.generated.h"
+
+
+/* Allowed cost per simulated frame. Category budgets scale linearly with the population so super-linear growth shows up as a failure. */
+USTRUCT(BlueprintType)
+struct FShooterAIBenchmarkBudget
+{
+	GENERATED_BODY()
+
+	/* Milliseconds of AI logic per frame for every 100 pawns */
+	UPROPERTY(EditAnywhere, Category = "Budget")
+	float LogicMsPer100;
+
+	UPROPERTY(EditAnywhere, Category = "Budget")
+	float NavigationMsPer100;
+
+	UPROPERTY(EditAnywhere, Category = "Budget")
+	float MovementMsPer100;
+
+	UPROPERTY(EditAnywhere, Category = "Budget")
+	float PerceptionMsPer100;
+
+	/* Absolute limit for the whole frame, independent of population (0 = not checked) */
+	UPROPERTY(EditAnywhere, Category = "Budget")
+	float MaxFrameMs;
+
+	FShooterAIBenchmarkBudget()
+		: LogicMsPer100(0.5f),
+		NavigationMsPer100(1.0f),
+		MovementMsPer100(2.0f),
+		PerceptionMsPer100(1.0f),
+		MaxFrameMs(0.0f)
+	{}
+};
+
+
+/**
+* Spawns increasing populations of zombies and tracker bots, runs each for a fixed amount of simulated time and records the
+* AI, navigation, movement and perception cost per frame as a scaling curve (written as CSV to Saved/Profiling).
+*
+* Headless usage (exit code is non-zero when a budget is exceeded):
+*	UE4Editor prototype P_TestMap -game -nullrhi -unattended -nosound -AIBenchmark
+*/
+UCLASS(Blueprintable)
+class PROTOTYPE_API AShooterAIBenchmark : public AActor
+{
+	GENERATED_BODY()
+
+public:
+
+	AShooterAIBenchmark();
+
+	void StartBenchmark();
+
+	bool HasFailed() const;
+
+protected:
+
+	virtual void Tick(float DeltaSeconds) override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/* Number of pawns to spawn for each step of the curve, every size is run once per pawn class */
+	UPROPERTY(EditAnywhere, Category = "Benchmark")
+	TArray<int32> PopulationSizes;
+
+	UPROPERTY(EditAnywhere, Category = "Benchmark")
+	TSubclassOf<APawn> ZombieClass;
+
+	UPROPERTY(EditAnywhere, Category = "Benchmark")
+	TSubclassOf<APawn> TrackerBotClass;
+
+	/* Optional pawn spawned at the center for the AI to sense and chase */
+	UPROPERTY(EditAnywhere, Category = "Benchmark")
+	TSubclassOf<APawn> TargetPawnClass;
+
+	/* Pawns are spawned on the navmesh within this radius of the benchmark actor */
+	UPROPERTY(EditAnywhere, Category = "Benchmark")
+	float SpawnRadius;
+
+	/* Simulated seconds to let the population settle before sampling */
+	UPROPERTY(EditAnywhere, Category = "Benchmark")
+	float WarmupSeconds;
+
+	/* Simulated seconds sampled per step */
+	UPROPERTY(EditAnywhere, Category = "Benchmark")
+	float SampleSeconds;
+
+	/* Every frame advances the world by exactly 1 / FixedFrameRate, making runs comparable regardless of machine speed (0 = real time) */
+	UPROPERTY(EditAnywhere, Category = "Benchmark")
+	float FixedFrameRate;
+
+	UPROPERTY(EditAnywhere, Category = "Benchmark")
+	FShooterAIBenchmarkBudget Budget;
+
+	/* Request engine exit when done, with exit code 1 on budget failures */
+	UPROPERTY(EditAnywhere, Category = "Benchmark")
+	bool bQuitWhenFinished;
+
+	/* File name of the CSV report inside the profiling directory */
+	UPROPERTY(EditAnywhere, Category = "Benchmark")
+	FString ReportFileName;
+
+private:
+
+	enum class EPhase : uint8
+	{
+		Idle,
+		Warmup,
+		Sampling,
+		Finished
+	};
+
+	struct FBenchmarkStep
+	{
+		TSubclassOf<APawn> PawnClass;
+
+		int32 Population;
+	};
+
+	struct FBenchmarkResult
+	{
+		FString Label;
+
+		int32 Population;
+
+		int32 Frames;
+
+		double AverageMs[(int32)EShooterAIStat::Count];
+
+		double AverageFrameMs;
+
+		bool bOverBudget;
+	};
+
+	void BeginStep();
+
+	void EndStep();
+
+	void FinishBenchmark();
+
+	/* The fixed time step is engine wide, put back what was set before the benchmark */
+	void RestoreTimeStep();
+
+	void SpawnPopulation(TSubclassOf<APawn> PawnClass, int32 Count);
+
+	void DestroyPopulation();
+
+	FVector FindSpawnLocation() const;
+
+	bool IsOverBudget(const FBenchmarkResult& Result) const;
+
+	void WriteReport() const;
+
+	TArray<FBenchmarkStep> Steps;
+
+	TArray<FBenchmarkResult> Results;
+
+	UPROPERTY(Transient)
+	TArray<APawn*> SpawnedPawns;
+
+	UPROPERTY(Transient)
+	APawn* TargetPawn;
+
+	EPhase Phase;
+
+	int32 CurrentStep;
+
+	float PhaseTime;
+
+	int32 SampledFrames;
+
+	double SampledMs[(int32)EShooterAIStat::Count];
+
+	double SampledFrameMs;
+
+	double LastFrameTime;
+
+	bool bFailed;
+
+	bool bOverrodeTimeStep;
+
+	bool bPreviousUseFixedTimeStep;
+
+	double PreviousFixedDeltaTime;
+};
@@ -25,6 +25,16 @@ class PROTOTYPE_API AShooterCoopGameMode : public AShooterGameMode
 	/* Spawn the player next to his living coop buddy instead of a PlayerStart */
 	virtual void RestartPlayer(class AController* NewPlayer) override;
 
+	void OnRestartLocationFound(bool bSuccess, const FVector& StartLocation, TWeakObjectPtr<AController> Player, FRotator StartRotation);
+
+	void RestartPlayerAtLocation(AController* NewPlayer, const FVector& StartLocation, const FRotator& StartRotation);
+
+	/* Switch the HUD back to playing once the restarted player possesses a pawn */
+	void NotifyPlayerRestarted(AController* NewPlayer);
+
+	/* Players waiting for a spawn location query, so repeated restarts don't queue twice */
+	TSet<TWeakObjectPtr<AController>> PendingRestarts;
+
 	virtual void OnNightEnded() override;
 
 	/* Spawn at team player if any are alive */
@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "World/ShooterTickableWorldSubsystem.h"
+#include "Engine/EngineTypes.h"
+#include "ShooterDamageBatchSubsystem.generated.h"
+
+class AShooterBaseCharacter;
+
+
+/* One TakeDamage call held back until the end of the frame, keeps the damage event it was dealt with */
+struct FShooterQueuedHit
+{
+	float Damage;
+
+	TWeakObjectPtr<AController> EventInstigator;
+
+	TWeakObjectPtr<AActor> DamageCauser;
+
+	FShooterQueuedHit()
+		: Damage(0.0f)
+		, DamageEventClassID(0)
+	{
+	}
+
+	void SetDamageEvent(const FDamageEvent& DamageEvent);
+
+	const FDamageEvent& GetDamageEvent() const;
+
+	/* Hits of the same instigator, causer and damage type are applied together */
+	bool IsSameSource(const FShooterQueuedHit& Other) const;
+
+private:
+
+	int32 DamageEventClassID;
+
+	FDamageEvent GeneralDamageEvent;
+
+	FPointDamageEvent PointDamageEvent;
+
+	FRadialDamageEvent RadialDamageEvent;
+};
+
+
+/**
+* Coalesces the damage characters take within a frame. TakeDamage only queues the hit, at the end of the frame the hits of every
+* victim are summed up per source (instigator, causer and damage type) so the game mode rules, the health change and the replicated
+* hit run once per source instead of once per pellet or explosion. The killing hit still decides the kill credit and the death impulse.
+*/
+UCLASS()
+class PROTOTYPE_API UShooterDamageBatchSubsystem : public UShooterTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	/* Returns false when damage is not coalesced, the caller applies it right away */
+	bool QueueDamage(AShooterBaseCharacter* Victim, float Damage, const FDamageEvent& DamageEvent, AController* EventInstigator, AActor* DamageCauser);
+
+	/* Begin FTickableGameObject */
+	virtual void Tick(float DeltaTime) override;
+	/* End FTickableGameObject */
+
+protected:
+
+	virtual bool HasPendingWork() const override;
+
+	virtual void Deinitialize() override;
+
+private:
+
+	struct FPendingVictim
+	{
+		TWeakObjectPtr<AShooterBaseCharacter> Victim;
+
+		/* In the order they were dealt */
+		TArray<FShooterQueuedHit, TInlineAllocator<8>> Hits;
+	};
+
+	TArray<FPendingVictim> PendingVictims;
+
+	/* Swapped with the pending victims while they are applied, damage dealt in the meantime waits for the next frame */
+	TArray<FPendingVictim> FlushingVictims;
+};
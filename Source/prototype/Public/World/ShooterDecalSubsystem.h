@@ -0,0 +1,87 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "World/ShooterTickableWorldSubsystem.h"
+#include "../ShooterTypes.h"
+#include "ShooterDecalSubsystem.generated.h"
+
+class UDecalComponent;
+class UMaterialInterface;
+
+
+/* Fixed size ring of decal components, the slot at Next holds the oldest decal */
+USTRUCT()
+struct FShooterDecalRing
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(Transient)
+	TArray<UDecalComponent*> Components;
+
+	/* World time at which the decal of the same slot has faded out and gets hidden */
+	TArray<float> ExpireTimes;
+
+	int32 Next;
+
+	FShooterDecalRing()
+		: Next(0)
+	{
+	}
+};
+
+
+/**
+* Owns every short lived decal of the world (bullet holes, footprints). Each category has a fixed capacity ring buffer,
+* a new decal reuses the component of the oldest one. Decals fade out by age and by screen size (distance),
+* and spawns are skipped on dedicated servers and outside the view of local players, so decal count and memory are bounded.
+*/
+UCLASS()
+class PROTOTYPE_API UShooterDecalSubsystem : public UShooterTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	/**
+	* Place a decal, LifeSpan includes the fade out. When AttachTo is set the decal follows that component (and bone).
+	* Returns nullptr when the decal was skipped.
+	*/
+	UDecalComponent* SpawnDecal(EShooterDecalCategory Category, UMaterialInterface* Material, const FVector& Size, const FVector& Location, const FRotator& Rotation,
+		float LifeSpan, USceneComponent* AttachTo = nullptr, FName AttachBoneName = NAME_None);
+
+	/* Cheap view cone test against the cameras of local players, Radius is added as margin */
+	bool IsInView(const FVector& Location, float Radius) const;
+
+	/* Begin FTickableGameObject */
+	virtual void Tick(float DeltaTime) override;
+	/* End FTickableGameObject */
+
+protected:
+
+	virtual bool HasPendingWork() const override;
+
+	virtual void Deinitialize() override;
+
+private:
+
+	struct FViewer
+	{
+		FVector Location;
+
+		FVector Direction;
+
+		/* Cosine of half the field of view including the margin */
+		float CosHalfFOV;
+	};
+
+	void AllocateRing(EShooterDecalCategory Category);
+
+	void UpdateViewers();
+
+	UPROPERTY(Transient)
+	TArray<FShooterDecalRing> Rings;
+
+	TArray<FViewer> Viewers;
+};
@@ -0,0 +1,88 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "World/ShooterTickableWorldSubsystem.h"
+#include "ShooterEffectsSubsystem.generated.h"
+
+class AShooterImpactEffect;
+class UParticleSystem;
+class UParticleSystemComponent;
+class UMaterialInterface;
+class USoundCue;
+
+
+/**
+* Plays bullet impact, tracer and trail effects without spawning actors. Particle components are allocated once per
+* world and reused round-robin, bullet holes go through the decal budget of UShooterDecalSubsystem. The impact assets
+* are looked up in a per template table indexed by surface type.
+* Impacts and trails are skipped beyond their per-frame caps and thinned out by distance through the significance budget.
+*/
+UCLASS()
+class PROTOTYPE_API UShooterEffectsSubsystem : public UShooterTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	/* Template supplies the effect assets (its class defaults), never call this on dedicated servers */
+	void PlayImpactEffect(TSubclassOf<AShooterImpactEffect> Template, const FHitResult& Impact, EPhysicalSurface SurfaceType);
+
+	/* Tracer round flying from Origin towards EndPoint. Remote shots are subject to distance culling */
+	void PlayTracer(UParticleSystem* Template, const FVector& Origin, const FVector& EndPoint, bool bFromRemotePlayer);
+
+	/* Beam style trail, TrailTargetParam of the template receives EndPoint. Remote shots are subject to distance culling */
+	void PlayTrail(UParticleSystem* Template, FName TrailTargetParam, const FVector& Origin, const FVector& EndPoint, bool bFromRemotePlayer);
+
+	/* Begin FTickableGameObject */
+	virtual void Tick(float DeltaTime) override;
+	/* End FTickableGameObject */
+
+protected:
+
+	virtual bool HasPendingWork() const override;
+
+	virtual void Deinitialize() override;
+
+private:
+
+	struct FImpactEffectTable
+	{
+		UParticleSystem* FX[SurfaceType_Max];
+
+		USoundCue* Sounds[SurfaceType_Max];
+
+		UMaterialInterface* DecalMaterial;
+
+		float DecalSize;
+
+		float DecalLifeSpan;
+	};
+
+	const FImpactEffectTable& GetImpactTable(TSubclassOf<AShooterImpactEffect> Template);
+
+	void AllocatePools();
+
+	UParticleSystemComponent* GetNextParticleComponent();
+
+	/* Null when the trail is over the frame budget or too far from every viewer */
+	UParticleSystemComponent* ClaimTrailComponent(UParticleSystem* Template, const FVector& Origin, const FVector& EndPoint, bool bFromRemotePlayer);
+
+	TMap<const UClass*, FImpactEffectTable> ImpactTables;
+
+	UPROPERTY(Transient)
+	TArray<UParticleSystemComponent*> ParticlePool;
+
+	/* Separate from the impacts so a burst of tracers doesn't cut off impact effects */
+	UPROPERTY(Transient)
+	TArray<UParticleSystemComponent*> TrailPool;
+
+	int32 NextParticle;
+
+	int32 NextTrail;
+
+	int32 NumImpactsThisFrame;
+
+	int32 NumTrailsThisFrame;
+};
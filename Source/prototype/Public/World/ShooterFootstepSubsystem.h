@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "World/ShooterTickableWorldSubsystem.h"
+#include "WorldCollision.h"
+#include "ShooterFootstepSubsystem.generated.h"
+
+class AShooterBaseCharacter;
+
+
+/**
+* Places the footprints of every character. Steps are queued by the animation, traced together as one batch of async traces
+* at the end of the frame (capped per frame) and turned into decals of the footprint ring when the results come in.
+* The physical material is only requested when a character stepped onto another floor, its surface is cached until then.
+* Floors with several surfaces (landscapes, meshes with more than one material) are looked up again every few steps.
+*/
+UCLASS()
+class PROTOTYPE_API UShooterFootstepSubsystem : public UShooterTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	/* FallbackLifeSpan is used when the decal actor class sets neither a life span nor a fade out */
+	void QueueFootstep(AShooterBaseCharacter* Character, const FVector& FootLocation, const FVector& FootForward, TSubclassOf<AActor> FootprintDecal, float FallbackLifeSpan);
+
+	/* Begin FTickableGameObject */
+	virtual void Tick(float DeltaTime) override;
+	/* End FTickableGameObject */
+
+protected:
+
+	virtual bool HasPendingWork() const override;
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	virtual void Deinitialize() override;
+
+private:
+
+	struct FPendingFootstep
+	{
+		TWeakObjectPtr<AShooterBaseCharacter> Character;
+
+		FVector Location;
+
+		FVector Forward;
+
+		TSubclassOf<AActor> FootprintDecal;
+
+		float FallbackLifeSpan;
+
+		/* The character stands on another floor than the one its surface was cached for, or moved on across a mixed floor */
+		bool bWantsSurface;
+
+		uint32 Id;
+	};
+
+	void OnFootTraceComplete(const FTraceHandle& Handle, FTraceDatum& Datum);
+
+	void PlaceFootprint(const FPendingFootstep& Footstep, const FHitResult& Hit);
+
+	/* Steps of this frame, traced in Tick */
+	TArray<FPendingFootstep> QueuedFootsteps;
+
+	/* Traced, waiting for the result */
+	TArray<FPendingFootstep> TracingFootsteps;
+
+	FTraceDelegate TraceDelegate;
+
+	uint32 NextFootstepId;
+};
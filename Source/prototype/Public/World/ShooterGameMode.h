@@ -131,6 +131,14 @@ protected:
 	/* Set all bots to active patrolling state */
 	void WakeAllBots();
 
+	/* Benchmark actor used by StartAIBenchmark and the -AIBenchmark command line switch */
+	UPROPERTY(EditDefaultsOnly, Category = "Debug")
+	TSubclassOf<class AShooterAIBenchmark> AIBenchmarkClass;
+
+	/* Measure AI cost for increasing bot populations (Exec only valid when testing in Singleplayer) */
+	UFUNCTION(Exec, Category = "GameMode")
+	void StartAIBenchmark();
+
 public:
 
 	/* Primary sun of the level. Assigned in Blueprint during BeginPlay (BlueprintReadWrite is required as tag instead of EditDefaultsOnly) */
@@ -0,0 +1,114 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "World/ShooterTickableWorldSubsystem.h"
+#include "ShooterLagCompensationSubsystem.generated.h"
+
+class AShooterBaseCharacter;
+class UPhysicalMaterial;
+
+
+/**
+* Server-side hit validation against the past. Every frame the hitbox capsules (physics asset bodies) of each registered character
+* are recorded into a fixed size ring buffer. Client hit reports are re-traced against the hitboxes rewound to the client's shot time.
+* Lookups go straight to the history of the claimed actor and a bounding sphere test rejects most misses before any capsule is tested,
+* so validating a shot does not depend on the number of pawns.
+*/
+UCLASS()
+class PROTOTYPE_API UShooterLagCompensationSubsystem : public UShooterTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	/* Start recording the character (server only) */
+	void Register(AShooterBaseCharacter* Character);
+
+	void Unregister(AShooterBaseCharacter* Character);
+
+	bool IsTracked(const AActor* Actor) const;
+
+	/* Time stamp clients should send with their shots, in the same clock the history is recorded in */
+	static float GetShotTimestamp(const UObject* WorldContextObject);
+
+	/**
+	* Trace Start -> End against the hitboxes of Character as they were at Timestamp.
+	* On success OutHit holds the impact on the closest hitbox, including the bone and physical material of that body.
+	*/
+	bool RewindTrace(const AShooterBaseCharacter* Character, float Timestamp, const FVector& Start, const FVector& End, FHitResult& OutHit) const;
+
+	/* Begin FTickableGameObject */
+	virtual void Tick(float DeltaTime) override;
+	/* End FTickableGameObject */
+
+protected:
+
+	virtual bool HasPendingWork() const override;
+
+	virtual void Deinitialize() override;
+
+private:
+
+	/* Static description of one body, captured at registration */
+	struct FHitboxShape
+	{
+		/* INDEX_NONE for the collision capsule fallback */
+		int32 BoneIndex;
+
+		FName BoneName;
+
+		/* Relative to the bone */
+		FTransform LocalTransform;
+
+		float Radius;
+
+		float HalfLength;
+
+		TWeakObjectPtr<UPhysicalMaterial> PhysMaterial;
+	};
+
+	/* One recorded capsule, the segment runs from Center - HalfAxis to Center + HalfAxis */
+	struct FHitboxSample
+	{
+		FVector Center;
+
+		FVector HalfAxis;
+	};
+
+	typedef TArray<FHitboxSample, TInlineAllocator<32>> FHitboxSampleArray;
+
+	struct FCharacterHistory
+	{
+		TWeakObjectPtr<AShooterBaseCharacter> Character;
+
+		TArray<FHitboxShape> Shapes;
+
+		/* Index of the most recent frame */
+		int32 Head;
+
+		int32 NumFrames;
+
+		/* Per frame, indexed by ring position */
+		TArray<float> Timestamps;
+
+		/* Per frame bounding sphere of all hitboxes (XYZ center, W radius) */
+		TArray<FVector4> Bounds;
+
+		/* Frame-major: all hitboxes of ring position 0, then all of position 1 and so on */
+		TArray<FHitboxSample> Samples;
+	};
+
+	void BuildShapes(AShooterBaseCharacter* Character, TArray<FHitboxShape>& OutShapes) const;
+
+	void RecordFrame(FCharacterHistory& History, float Timestamp);
+
+	/* Interpolate the hitboxes at Timestamp (clamped to the recorded range), returns the bounding sphere */
+	FVector4 GetRewoundHitboxes(const FCharacterHistory& History, float Timestamp, FHitboxSampleArray& OutSamples) const;
+
+	TArray<FCharacterHistory> Histories;
+
+	/* Character -> index in Histories */
+	TMap<TWeakObjectPtr<const AActor>, int32> HistoryLookup;
+};
@@ -0,0 +1,222 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "World/ShooterTickableWorldSubsystem.h"
+#include "AI/Navigation/NavigationTypes.h"
+#include "ShooterNavQuerySubsystem.generated.h"
+
+class ANavigationData;
+
+
+/* Result of a random point query, called on the game thread during a later tick (never from within the request call) */
+DECLARE_DELEGATE_TwoParams(FShooterNavPointQueryDelegate, bool /* bSuccess */, const FVector& /* Location */);
+
+/* Result of a path query, PathPoints includes the start and end location */
+DECLARE_DELEGATE_TwoParams(FShooterNavPathQueryDelegate, bool /* bSuccess */, const TArray<FVector>& /* PathPoints */);
+
+
+/**
+* Central queue for navigation queries made by AI and game modes.
+* Requests are resolved from a cache (keyed by quantized origin/radius or start/end) or run on the game thread within a per-frame time budget.
+* Long paths are resolved hierarchically: a route between two grid clusters is searched once and shared, only the short pieces
+* from the start onto the route and from the route to the goal are searched per request.
+* Queue latency and cache hit rate are exposed through "stat ShooterAI" and COOP.NavQueryStats.
+*/
+UCLASS()
+class PROTOTYPE_API UShooterNavQuerySubsystem : public UShooterTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	/* Find a random navigable point within radius. Returns a request id that can be passed to CancelRequest (0 if the request could not be queued) */
+	uint32 RequestRandomPointInRadius(const FVector& Origin, float Radius, FShooterNavPointQueryDelegate OnComplete);
+
+	/* Find a path for Querier (its nav agent properties and filter are used when it implements INavAgentInterface) */
+	uint32 RequestPath(const FVector& Start, const FVector& End, const UObject* Querier, FShooterNavPathQueryDelegate OnComplete);
+
+	/* The callback of a cancelled request is never called */
+	void CancelRequest(uint32 RequestId);
+
+	/* Drop all cached results and cluster routes, called whenever the navmesh is rebuilt */
+	void FlushCache();
+
+	int32 GetNumPendingRequests() const;
+
+	/* Ratio of requests answered from the cache since the last stats reset */
+	float GetCacheHitRate() const;
+
+	/* Average time in milliseconds between a request and its callback since the last stats reset */
+	float GetAverageLatencyMs() const;
+
+	void ResetStats();
+
+	/* Begin FTickableGameObject */
+	virtual void Tick(float DeltaTime) override;
+	/* End FTickableGameObject */
+
+protected:
+
+	virtual void Deinitialize() override;
+
+private:
+
+	enum class EQueryType : uint8
+	{
+		RandomPoint,
+		Path
+	};
+
+	struct FQueryRequest
+	{
+		uint32 RequestId;
+
+		EQueryType Type;
+
+		FVector Origin;
+
+		/* Path end location, unused for point queries */
+		FVector End;
+
+		float Radius;
+
+		TWeakObjectPtr<const UObject> Querier;
+
+		FNavAgentProperties AgentProperties;
+
+		FShooterNavPointQueryDelegate OnPointComplete;
+
+		FShooterNavPathQueryDelegate OnPathComplete;
+
+		double RequestTime;
+
+		bool bCancelled;
+
+		/* Result, set once the request was resolved */
+		bool bSuccess;
+
+		FVector Location;
+
+		TArray<FVector> PathPoints;
+	};
+
+	struct FCacheKey
+	{
+		EQueryType Type;
+
+		FIntVector Origin;
+
+		FIntVector End;
+
+		int32 Radius;
+
+		bool operator==(const FCacheKey& Other) const
+		{
+			return Type == Other.Type && Origin == Other.Origin && End == Other.End && Radius == Other.Radius;
+		}
+
+		friend uint32 GetTypeHash(const FCacheKey& Key)
+		{
+			uint32 Hash = HashCombine(GetTypeHash(Key.Origin), GetTypeHash(Key.End));
+			return HashCombine(Hash, GetTypeHash(Key.Radius) ^ (uint32)Key.Type);
+		}
+	};
+
+	struct FCacheEntry
+	{
+		/* Several random points are kept per key so repeated patrol queries don't all end up at the same spot */
+		TArray<FVector> Points;
+
+		bool bSuccess;
+
+		double ExpireTime;
+	};
+
+	struct FClusterRouteKey
+	{
+		FIntVector From;
+
+		FIntVector To;
+
+		int32 AgentRadius;
+
+		bool operator==(const FClusterRouteKey& Other) const
+		{
+			return From == Other.From && To == Other.To && AgentRadius == Other.AgentRadius;
+		}
+
+		friend uint32 GetTypeHash(const FClusterRouteKey& Key)
+		{
+			return HashCombine(HashCombine(GetTypeHash(Key.From), GetTypeHash(Key.To)), GetTypeHash(Key.AgentRadius));
+		}
+	};
+
+	uint32 QueueRequest(FQueryRequest&& Request);
+
+	FCacheKey MakeCacheKey(const FQueryRequest& Request) const;
+
+	/* Fill the result from the cache, returns false on a miss */
+	bool ResolveFromCache(FQueryRequest& Request);
+
+	void StoreInCache(const FQueryRequest& Request);
+
+	void RunQuery(FQueryRequest& Request);
+
+	/* Full A* search on the navmesh */
+	bool FindPathDirect(const FQueryRequest& Request, const FVector& Start, const FVector& End, TArray<FVector>& OutPathPoints);
+
+	/* Cached cluster route plus local searches at both ends, returns false when the caller should search directly */
+	bool FindHierarchicalPath(const FQueryRequest& Request, TArray<FVector>& OutPathPoints);
+
+	FIntVector GetCluster(const FVector& Location) const;
+
+	/* Navigable point representing the cluster, the first location queried in a cluster becomes its node */
+	bool GetClusterNode(const FIntVector& Cluster, const FVector& Hint, FVector& OutNode);
+
+	void CompleteRequest(FQueryRequest& Request);
+
+	void PruneCache();
+
+	void UpdateStats(float DeltaTime);
+
+	void OnNavigationGenerationFinished(ANavigationData* NavData);
+
+	TArray<FQueryRequest> PendingRequests;
+
+	/* Cache hits waiting for the next tick so callbacks never run inside the request call */
+	TArray<FQueryRequest> ResolvedRequests;
+
+	TMap<FCacheKey, FCacheEntry> Cache;
+
+	TMap<FIntVector, FVector> ClusterNodes;
+
+	/* Path points between two cluster nodes, empty when unreachable */
+	TMap<FClusterRouteKey, TArray<FVector>> ClusterRoutes;
+
+	uint32 NextRequestId;
+
+	bool bBoundToNavigation;
+
+	double LastPruneTime;
+
+	/* Stats since the last reset */
+	int32 NumRequests;
+
+	int32 NumCacheHits;
+
+	int32 NumCompleted;
+
+	double TotalLatencySeconds;
+
+	double MaxLatencySeconds;
+
+	int32 NumPathSearches;
+
+	int32 NumHierarchicalPaths;
+
+	int32 NumRouteCacheHits;
+
+	float StatsReportTime;
+};
@@ -0,0 +1,129 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "World/ShooterTickableWorldSubsystem.h"
+#include "WorldCollision.h"
+#include "ShooterProjectileSubsystem.generated.h"
+
+class AShooterGrenadeProjectile;
+class UInstancedStaticMeshComponent;
+
+
+/* Movement settings of one projectile class, read once from its class defaults */
+USTRUCT()
+struct FShooterProjectileClassInfo
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(Transient)
+	UClass* ProjectileClass;
+
+	/* All simulated projectiles of the class are drawn as instances of this component, null on dedicated servers */
+	UPROPERTY(Transient)
+	UInstancedStaticMeshComponent* Visuals;
+
+	float Radius;
+
+	float InitialSpeed;
+
+	float MaxSpeed;
+
+	float GravityScale;
+
+	float Bounciness;
+
+	float Friction;
+
+	/* A bounce leaving less speed than this stops the projectile */
+	float StopSpeed;
+
+	float LifeSpan;
+
+	bool bShouldBounce;
+
+	TEnumAsByte<ECollisionChannel> CollisionChannel;
+
+	FCollisionResponseParams ResponseParams;
+
+	FShooterProjectileClassInfo()
+		: ProjectileClass(nullptr)
+		, Visuals(nullptr)
+		, Radius(0.0f)
+		, InitialSpeed(0.0f)
+		, MaxSpeed(0.0f)
+		, GravityScale(1.0f)
+		, Bounciness(0.0f)
+		, Friction(0.0f)
+		, StopSpeed(0.0f)
+		, LifeSpan(0.0f)
+		, bShouldBounce(false)
+		, CollisionChannel(ECC_WorldDynamic)
+	{
+	}
+};
+
+
+/**
+* Simulates grenade projectiles as plain records instead of actors. All projectiles are moved and swept in one pass per frame
+* and drawn through one instanced mesh per projectile class. A projectile only becomes its actor class once it needs the actor:
+* when it touches a physics simulated object, or when it comes to rest and explodes.
+*/
+UCLASS()
+class PROTOTYPE_API UShooterProjectileSubsystem : public UShooterTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	/* Returns false when the class can't be simulated, the caller spawns the actor instead */
+	bool LaunchProjectile(TSubclassOf<AActor> ProjectileClass, const FVector& Location, const FRotator& Rotation, APawn* Instigator);
+
+	/* Begin FTickableGameObject */
+	virtual void Tick(float DeltaTime) override;
+	/* End FTickableGameObject */
+
+protected:
+
+	virtual bool HasPendingWork() const override;
+
+	virtual void Deinitialize() override;
+
+private:
+
+	struct FSimulatedProjectile
+	{
+		FVector Location;
+
+		FVector Velocity;
+
+		/* Start with the class defaults, replaced by the physical material of every surface bounced off */
+		float Bounciness;
+
+		float Friction;
+
+		float ExpireTime;
+
+		/* Ignored by the sweeps, instigator of the actor once promoted */
+		TWeakObjectPtr<APawn> Instigator;
+
+		uint8 ClassIndex;
+	};
+
+	/* INDEX_NONE when the class can't be simulated */
+	int32 FindOrAddClassInfo(TSubclassOf<AActor> ProjectileClass);
+
+	/* Replace the record by its actor, StopHit set when the projectile came to rest on that hit */
+	void PromoteProjectile(int32 Index, const FHitResult* StopHit);
+
+	void UpdateVisuals();
+
+	UPROPERTY(Transient)
+	TArray<FShooterProjectileClassInfo> ClassInfos;
+
+	TArray<FSimulatedProjectile> Projectiles;
+
+	/* Reused every frame to batch the instance updates */
+	TArray<FTransform> InstanceTransforms;
+};
@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "World/ShooterTickableWorldSubsystem.h"
+#include "ShooterRagdollSubsystem.generated.h"
+
+class AShooterBaseCharacter;
+
+
+/**
+* Budget for dead bodies. Only a fixed number of ragdolls simulate at once: when a new one starts the oldest simulating body
+* is frozen, and bodies that came to rest or are far from every local player are frozen early. A frozen body keeps its last pose
+* without physics or animation. Past the total body budget the oldest corpse is removed. Dedicated servers don't simulate ragdolls.
+*/
+UCLASS()
+class PROTOTYPE_API UShooterRagdollSubsystem : public UShooterTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	/* False when the body should not ragdoll at all (dedicated server), the caller hides it instead */
+	bool ShouldSimulateRagdoll() const;
+
+	/* The mesh of Character simulates already, it is frozen or removed once it runs out of budget */
+	void AddRagdoll(AShooterBaseCharacter* Character);
+
+	/* Begin FTickableGameObject */
+	virtual void Tick(float DeltaTime) override;
+	/* End FTickableGameObject */
+
+protected:
+
+	virtual bool HasPendingWork() const override;
+
+	virtual void Deinitialize() override;
+
+private:
+
+	struct FRagdoll
+	{
+		TWeakObjectPtr<AShooterBaseCharacter> Character;
+
+		float StartTime;
+
+		/* Time the body has been below the settle speed */
+		float SettledTime;
+
+		bool bFrozen;
+	};
+
+	/* Stop the physics of the body and keep its current pose */
+	void FreezeRagdoll(FRagdoll& Ragdoll);
+
+	float GetDistanceToViewers(const FVector& Location) const;
+
+	/* Oldest first */
+	TArray<FRagdoll> Ragdolls;
+
+	TArray<FVector> ViewerLocations;
+
+	float TimeSinceUpdate;
+};
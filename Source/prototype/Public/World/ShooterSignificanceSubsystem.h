@@ -0,0 +1,98 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "World/ShooterTickableWorldSubsystem.h"
+#include "../ShooterTypes.h"
+#include "ShooterSignificanceSubsystem.generated.h"
+
+
+/* Called on the game thread whenever the tier of a registered actor changes */
+DECLARE_DELEGATE_TwoParams(FShooterSignificanceChanged, EShooterSignificance /* OldSignificance */, EShooterSignificance /* NewSignificance */);
+
+
+/**
+* Ranks actors by distance and view direction to the viewers of this world (local players on clients, all players on the server)
+* and hands out a bounded number of High and Medium slots per category. Owners react to tier changes by adjusting
+* tick rates, animation, audio, net update frequency and effect detail, so cost is bounded by the budget rather than the population.
+*/
+UCLASS()
+class PROTOTYPE_API UShooterSignificanceSubsystem : public UShooterTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	/* Long lived actors are re-ranked periodically, OnChanged is called right away with the initial tier */
+	void Register(AActor* Actor, EShooterSignificanceCategory Category, FShooterSignificanceChanged OnChanged);
+
+	void Unregister(AActor* Actor);
+
+	/* High for actors that were never registered so unknown actors keep full fidelity */
+	EShooterSignificance GetSignificance(const AActor* Actor) const;
+
+	/**
+	* Tier for a short lived effect (impacts, footprints) about to be spawned at Location.
+	* Consumes one slot of that tier for the current frame, falling back to lower tiers once the frame budget is used up.
+	*/
+	EShooterSignificance ClaimEffectSignificance(EShooterSignificanceCategory Category, const FVector& Location);
+
+	/* Same for effects spanning a segment (bullet trails), ranked by the point of the segment closest to a viewer */
+	EShooterSignificance ClaimEffectSignificance(EShooterSignificanceCategory Category, const FVector& Start, const FVector& End);
+
+	/* Begin FTickableGameObject */
+	virtual void Tick(float DeltaTime) override;
+	/* End FTickableGameObject */
+
+protected:
+
+	virtual void Deinitialize() override;
+
+private:
+
+	struct FViewer
+	{
+		FVector Location;
+
+		FVector Direction;
+	};
+
+	struct FRegistration
+	{
+		EShooterSignificanceCategory Category;
+
+		EShooterSignificance Significance;
+
+		FShooterSignificanceChanged OnChanged;
+
+		/* Lower is more important */
+		float Score;
+	};
+
+	/* Distance to the closest viewer, scaled up for actors behind the viewer */
+	float CalculateScore(const FVector& Location) const;
+
+	float CalculateSegmentScore(const FVector& Start, const FVector& End) const;
+
+	EShooterSignificance ClaimEffectSlot(EShooterSignificanceCategory Category, float Score);
+
+	EShooterSignificance GetTierForScore(EShooterSignificanceCategory Category, float Score, int32 Rank) const;
+
+	void UpdateViewers();
+
+	void UpdateRegistrations();
+
+	void SetSignificance(AActor* Actor, FRegistration& Registration, EShooterSignificance NewSignificance);
+
+	void DrawDebug() const;
+
+	TArray<FViewer> Viewers;
+
+	TMap<TWeakObjectPtr<AActor>, FRegistration> Registrations;
+
+	/* Effect slots used this frame per category and tier */
+	int32 EffectClaims[(int32)EShooterSignificanceCategory::MAX][(int32)EShooterSignificance::High + 1];
+
+	float TimeSinceUpdate;
+};
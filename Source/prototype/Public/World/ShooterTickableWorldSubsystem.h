@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "Engine/World.h"
+#include "ShooterTickableWorldSubsystem.generated.h"
+
+
+/**
+* Base of the world subsystems that process the work of all actors of a game world in one tick per frame.
+* Only subsystems of game worlds tick, and only while they have pending work. The class default objects never tick.
+*/
+UCLASS(Abstract)
+class PROTOTYPE_API UShooterTickableWorldSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	/* Subsystem of the world WorldContextObject is in, null outside of a world */
+	template<typename T>
+	static T* Get(const UObject* WorldContextObject)
+	{
+		UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+		return World ? World->GetSubsystem<T>() : nullptr;
+	}
+
+	/* Begin FTickableGameObject */
+	virtual void Tick(float DeltaTime) override PURE_VIRTUAL(UShooterTickableWorldSubsystem::Tick, );
+
+	virtual bool IsTickable() const override final;
+
+	virtual TStatId GetStatId() const override;
+	/* End FTickableGameObject */
+
+protected:
+
+	/* Only asked for subsystems of game worlds. False skips the tick while there is nothing to do, or nothing to do in this net mode */
+	virtual bool HasPendingWork() const;
+
+	/* For pools of components that don't belong to an actor: owned by the world settings, set up and registered with the world */
+	template<typename T>
+	T* CreatePooledComponent(TFunctionRef<void(T*)> Setup) const
+	{
+		T* Component = NewObject<T>(GetPooledComponentOuter());
+		Setup(Component);
+		Component->RegisterComponentWithWorld(GetWorld());
+		return Component;
+	}
+
+private:
+
+	UObject* GetPooledComponentOuter() const;
+};
@@ -0,0 +1,51 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterWeaponPoolSubsystem.generated.h"
+
+class AShooterWeapon;
+
+
+/* Weapons of one class that are waiting to be handed out again */
+USTRUCT()
+struct FShooterWeaponPool
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(Transient)
+	TArray<AShooterWeapon*> Weapons;
+};
+
+
+/**
+* Server side pool of weapon actors keyed by class. Weapons removed from an inventory (death, drop) are reset and parked
+* dormant instead of destroyed, respawns and pickups take them from here before spawning a new actor. This saves the spawn
+* and keeps the actor channels of the clients from being closed and opened again when a whole team respawns.
+*/
+UCLASS()
+class PROTOTYPE_API UShooterWeaponPoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	static UShooterWeaponPoolSubsystem* Get(const UObject* WorldContextObject);
+
+	/* Server only. Reuses a pooled weapon of the class or spawns a new one */
+	AShooterWeapon* AcquireWeapon(TSubclassOf<AShooterWeapon> WeaponClass);
+
+	/* Server only. The weapon must have left its inventory, it is destroyed instead when the pool of its class is full */
+	void ReleaseWeapon(AShooterWeapon* Weapon);
+
+protected:
+
+	virtual void Deinitialize() override;
+
+private:
+
+	UPROPERTY(Transient)
+	TMap<UClass*, FShooterWeaponPool> Pools;
+};
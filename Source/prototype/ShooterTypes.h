@@ -46,6 +46,69 @@ enum class EBotBehaviorType : uint8
 };
 
 
+UENUM()
+enum class EZombieAudioState : uint8
+{
+	/* No vocal loop (not initialized yet or dead) */
+	None,
+
+	/* Standing still, no player sensed */
+	Idle,
+
+	/* Patrolling, no player sensed */
+	Wandering,
+
+	/* Chasing a sensed player */
+	Hunting,
+};
+
+
+/* Importance of an actor to the viewers, ordered from least to most important */
+UENUM()
+enum class EShooterSignificance : uint8
+{
+	/* Out of range, skip all cosmetic work */
+	Culled,
+
+	Low,
+
+	Medium,
+
+	/* Close to and in front of a viewer, full fidelity */
+	High,
+};
+
+
+/* Every category has its own budget of High and Medium slots */
+UENUM()
+enum class EShooterSignificanceCategory : uint8
+{
+	Zombie,
+
+	TrackerBot,
+
+	ImpactEffect,
+
+	Footprint,
+
+	WeaponTrail,
+
+	MAX UMETA(Hidden)
+};
+
+
+/* Each category recycles its own fixed number of decals */
+UENUM()
+enum class EShooterDecalCategory : uint8
+{
+	BulletHole,
+
+	Footprint,
+
+	MAX UMETA(Hidden)
+};
+
+
 USTRUCT()
 struct FTakeHitInfo
 {
@@ -83,6 +146,9 @@ private:
 	UPROPERTY()
 		FRadialDamageEvent RadialDamageEvent;
 
+	/* Physics body of the bone hit by a point damage event, replicated instead of the bone name */
+	int32 HitBodyIndex;
+
 public:
 	FTakeHitInfo()
 		: ActualDamage(0),
@@ -91,7 +157,8 @@ public:
 		DamageCauser(nullptr),
 		DamageEventClassID(0),
 		bKilled(false),
-		EnsureReplicationByte(0)
+		EnsureReplicationByte(0),
+		HitBodyIndex(INDEX_NONE)
 	{}
 
 	FDamageEvent& GetDamageEvent()
@@ -143,4 +210,23 @@ public:
 	{
 		EnsureReplicationByte++;
 	}
-};
\ No newline at end of file
+
+	/* Server: look up the body of the hit bone in the physics asset of the damaged mesh, after SetDamageEvent */
+	void PackHitBone(const class USkeletalMeshComponent* Mesh);
+
+	/* Client: restore the bone name of the point damage event from the replicated body */
+	void UnpackHitBone(const class USkeletalMeshComponent* Mesh);
+
+	/* Only the active damage event is sent, with the fields the hit reaction uses: quantized damage, shot direction, impact point and body */
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+
+template<>
+struct TStructOpsTypeTraits<FTakeHitInfo> : public TStructOpsTypeTraitsBase2<FTakeHitInfo>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};